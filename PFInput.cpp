@@ -0,0 +1,178 @@
+#include "PFInput.h"
+
+#include <Arduino.h>
+
+namespace PF_n
+{
+  /*
+    Constructor
+  */
+  axis_c::axis_c() :
+    _calibrated( false ),
+    _direction( 1 ),
+    _hysteresis( 0 ),
+    _inverse( false ),
+    _level( 0 ),
+    _mid( 0 )
+  {
+    initThresholds( _backwardThresholds, 0, 0 );
+    initThresholds( _forwardThresholds, 0, 0 );
+    initOutputs();
+  }
+
+  /*
+    Initialize axis with the values at full forward, at the centre and at full backward.
+    Values closer than deadband to the centre are mapped to brake, a step only changes if the value moved
+    hysteresis beyond its threshold.
+  */
+  void axis_c::init( int forward, int mid, int backward, unsigned int deadband, unsigned int hysteresis )
+  {
+    _calibrated = true;
+    _direction = forward < backward ? -1 : 1;
+    _hysteresis = hysteresis;
+    _level = 0;
+    _mid = mid;
+
+    initThresholds( _forwardThresholds, _direction * ( forward - mid ), deadband );
+    initThresholds( _backwardThresholds, _direction * ( mid - backward ), deadband );
+  }
+
+  /*
+    Calculate distances from the centre where the steps begin
+  */
+  void axis_c::initThresholds( int* thresholds, int range, unsigned int deadband )
+  {
+    const long span = range > int( deadband ) ? range - int( deadband ) : 0;
+
+    for ( int step = 0; step < STEP_NUM; step++ )
+    {
+      thresholds[ step ] = deadband + span * step / STEP_NUM;
+    }
+  }
+
+  /*
+    Calculate PWM-output for every step (direction inverted if necessary)
+  */
+  void axis_c::initOutputs()
+  {
+    _outputs[ STEP_NUM ] = transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
+
+    for ( int step = 1; step <= STEP_NUM; step++ )
+    {
+      const transmitter_c::pwmOutput_t forward  = transmitter_c::pwmOutput_t( transmitter_c::PWM_OUTPUT_FLOAT + step );
+      const transmitter_c::pwmOutput_t backward = transmitter_c::pwmOutput_t( transmitter_c::PWM_OUTPUT_BACKWARD_1 + 1 - step );
+
+      _outputs[ STEP_NUM + step ] = _inverse ? backward : forward;
+      _outputs[ STEP_NUM - step ] = _inverse ? forward : backward;
+    }
+  }
+
+  /*
+    Get step of a distance from the centre (negative: backward)
+  */
+  int axis_c::levelOf( int position ) const
+  {
+    const int* thresholds = position < 0 ? _backwardThresholds : _forwardThresholds;
+    const int  distance = position < 0 ? -position : position;
+    int        step = 0;
+
+    while ( step < STEP_NUM && distance >= thresholds[ step ] )
+    {
+      step++;
+    }
+
+    return position < 0 ? -step : step;
+  }
+
+  /*
+    Map a value to a PWM-output, brake until the axis is initialized
+  */
+  transmitter_c::pwmOutput_t axis_c::output( int value )
+  {
+    if ( !_calibrated )
+    {
+      return transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
+    }
+
+    const int position = _direction * ( value - _mid );
+    int       level = levelOf( position );
+
+    if ( level > _level )
+    {
+      const int lowerLevel = levelOf( position - _hysteresis );
+      level = lowerLevel > _level ? lowerLevel : _level;
+    }
+    else if ( level < _level )
+    {
+      const int upperLevel = levelOf( position + _hysteresis );
+      level = upperLevel < _level ? upperLevel : _level;
+    }
+
+    _level = level;
+
+    return _outputs[ STEP_NUM + _level ];
+  }
+
+  /*
+    Invert direction of the axis
+  */
+  void axis_c::setInverse( bool inverse )
+  {
+    if ( inverse != _inverse )
+    {
+      _inverse = inverse;
+      initOutputs();
+    }
+  }
+
+  /*
+    Constructor
+  */
+  joystick_c::joystick_c( transmitter_c& transmitter, transmitter_c::channel_t channel, int pinX, int pinY ) :
+    _channel( channel ),
+    _outputA( transmitter_c::PWM_OUTPUT_BRAKE_FLOAT ),
+    _outputB( transmitter_c::PWM_OUTPUT_BRAKE_FLOAT ),
+    _pinX( pinX ),
+    _pinY( pinY ),
+    _sent( false ),
+    _transmitter( transmitter )
+  {
+  }
+
+  /*
+    Initialize axes, the current position is the centre.
+    The X-axis controls output A, the Y-axis output B.
+  */
+  void joystick_c::calibrate( int xForward, int xBackward, int yForward, int yBackward, unsigned int deadband,
+                              unsigned int hysteresis )
+  {
+    _axisX.init( xForward, analogRead( _pinX ), xBackward, deadband, hysteresis );
+    _axisY.init( yForward, analogRead( _pinY ), yBackward, deadband, hysteresis );
+    _sent = false;
+  }
+
+  /*
+    Read joystick and send message if the outputs changed.
+    Combo-PWM messages are repeated by the transmitter, so nothing gets lost.
+  */
+  bool joystick_c::update( bool inverseX, bool inverseY )
+  {
+    _axisX.setInverse( inverseX );
+    _axisY.setInverse( inverseY );
+
+    const transmitter_c::pwmOutput_t outputA = _axisX.output( analogRead( _pinX ) );
+    const transmitter_c::pwmOutput_t outputB = _axisY.output( analogRead( _pinY ) );
+
+    if ( _sent && outputA == _outputA && outputB == _outputB )
+    {
+      return false;
+    }
+
+    _transmitter.setMessageComboPWM( _channel, outputA, false, outputB, false );
+    _outputA = outputA;
+    _outputB = outputB;
+    _sent = true;
+
+    return true;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef PF_INPUT_H
+#define PF_INPUT_H
+
+#include "PFTransmitter.h"
+
+namespace PF_n
+{
+  /*
+    Maps the value of an analog axis to a PWM step.
+    The thresholds are calculated once by init(), mapping a value only compares.
+  */
+  class axis_c
+  {
+  public:
+    axis_c();
+
+    void                       init( int, int, int, unsigned int, unsigned int );
+    transmitter_c::pwmOutput_t output( int );
+    void                       setInverse( bool );
+
+  private:
+    enum
+    {
+      STEP_NUM = 7
+    };
+
+    static void initThresholds( int*, int, unsigned int );
+
+    int  levelOf( int ) const;
+    void initOutputs();
+
+    int                        _backwardThresholds[ STEP_NUM ];
+    bool                       _calibrated;
+    int                        _direction;
+    int                        _forwardThresholds[ STEP_NUM ];
+    int                        _hysteresis;
+    bool                       _inverse;
+    int                        _level;
+    int                        _mid;
+    transmitter_c::pwmOutput_t _outputs[ 2 * STEP_NUM + 1 ];
+  };
+
+  /*
+    Reads a joystick and sends a Combo-PWM message if one of the outputs changed
+  */
+  class joystick_c
+  {
+  public:
+    joystick_c( transmitter_c&, transmitter_c::channel_t, int, int );
+
+    void calibrate( int, int, int, int, unsigned int, unsigned int );
+    bool update( bool, bool );
+
+  private:
+    axis_c                     _axisX;
+    axis_c                     _axisY;
+    transmitter_c::channel_t   _channel;
+    transmitter_c::pwmOutput_t _outputA;
+    transmitter_c::pwmOutput_t _outputB;
+    int                        _pinX;
+    int                        _pinY;
+    bool                       _sent;
+    transmitter_c&             _transmitter;
+  };
+}
+
+#endif
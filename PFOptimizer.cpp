@@ -0,0 +1,383 @@
+#include "PFOptimizer.h"
+
+namespace PF_n
+{
+  /*
+    Constructor
+  */
+  optimizer_c::optimizer_c( transmitter_c& transmitter, unsigned int holdRounds ) :
+    _airtime( 0 ),
+    _baselineAirtime( 0 ),
+    _holdRounds( holdRounds > 0 ? holdRounds : 1 ),
+    _transmitter( transmitter )
+  {
+    for ( int channel = transmitter_c::CHANNEL_1; channel < transmitter_c::CHANNEL_NUM; channel++ )
+    {
+      channelState_t& state = _channels[ channel ];
+
+      state.baseline = 0;
+      state.continuous = false;
+      state.known = false;
+      state.next = 0;
+      state.outputA = transmitter_c::PWM_OUTPUT_FLOAT;
+      state.outputB = transmitter_c::PWM_OUTPUT_FLOAT;
+      state.pending = 0;
+      state.targetA = transmitter_c::PWM_OUTPUT_FLOAT;
+      state.targetB = transmitter_c::PWM_OUTPUT_FLOAT;
+    }
+  }
+
+  /*
+    Airtime of the frames the transmitter was given to send in us, counted by update() every round
+  */
+  unsigned long optimizer_c::airtime() const
+  {
+    return _airtime;
+  }
+
+  /*
+    Airtime saved compared to sending the Combo-PWM message of the desired outputs in every round since they were
+    first set in us, negative if the toggle-bit left by Single-Output messages made the sent frames longer
+  */
+  long optimizer_c::savedAirtime() const
+  {
+    return long( _baselineAirtime ) - long( _airtime );
+  }
+
+  /*
+    Step of a PWM-output (negative: backward), brake has none
+  */
+  int optimizer_c::step( transmitter_c::pwmOutput_t output )
+  {
+    return output < transmitter_c::PWM_OUTPUT_BRAKE_FLOAT ? int( output ) : int( output ) - 16;
+  }
+
+  /*
+    PWM-output of a step
+  */
+  transmitter_c::pwmOutput_t optimizer_c::pwm( int step )
+  {
+    return transmitter_c::pwmOutput_t( step >= 0 ? step : 16 + step );
+  }
+
+  /*
+    Map a PWM-output to Combo-Direct if it has one
+  */
+  bool optimizer_c::comboDirect( transmitter_c::pwmOutput_t output, transmitter_c::comboDirectOutput_t& direct )
+  {
+    switch ( output )
+    {
+    case transmitter_c::PWM_OUTPUT_FLOAT:
+      direct = transmitter_c::COMBO_DIRECT_OUTPUT_FLOAT;
+      return true;
+
+    case transmitter_c::PWM_OUTPUT_FORWARD_7:
+      direct = transmitter_c::COMBO_DIRECT_OUTPUT_FORWARD;
+      return true;
+
+    case transmitter_c::PWM_OUTPUT_BACKWARD_7:
+      direct = transmitter_c::COMBO_DIRECT_OUTPUT_BACKWARD;
+      return true;
+
+    case transmitter_c::PWM_OUTPUT_BRAKE_FLOAT:
+      direct = transmitter_c::COMBO_DIRECT_OUTPUT_BRAKE_FLOAT;
+      return true;
+
+    default:
+      return false;
+    }
+  }
+
+  /*
+    Fewer frames first, then less airtime
+  */
+  bool optimizer_c::cheaper( const cost_t& cost, const cost_t& other )
+  {
+    return cost.frames < other.frames || ( cost.frames == other.frames && cost.airtime < other.airtime );
+  }
+
+  /*
+    Set a message on a channel
+  */
+  void optimizer_c::set( transmitter_c::channel_c& channel, const message_t& message )
+  {
+    switch ( message.kind )
+    {
+    case KIND_COMBO_DIRECT:
+      channel.setMessageComboDirect( transmitter_c::comboDirectOutput_t( message.valueA ),
+                                     transmitter_c::comboDirectOutput_t( message.valueB ) );
+      break;
+
+    case KIND_COMBO_PWM:
+      channel.setMessageComboPWM( transmitter_c::pwmOutput_t( message.valueA ), transmitter_c::pwmOutput_t( message.valueB ) );
+      break;
+
+    case KIND_SINGLE_OUTPUT_CSTID:
+      channel.setMessageSingleOutputCstid( transmitter_c::singleOutput_t( message.output ),
+                                           transmitter_c::singleOutputCstid_t( message.valueA ) );
+      break;
+
+    case KIND_SINGLE_OUTPUT_PWM:
+      channel.setMessageSingleOutputPWM( transmitter_c::singleOutput_t( message.output ),
+                                         transmitter_c::pwmOutput_t( message.valueA ) );
+      break;
+    }
+  }
+
+  /*
+    Frames and airtime of a message with the given toggle-bit, measured with the encoder of the transmitter.
+    A message which repeats forever is sent once per round until it is replaced.
+  */
+  optimizer_c::cost_t optimizer_c::cost( transmitter_c::channel_t channel, const message_t& message, bool toggle,
+                                         unsigned int rounds )
+  {
+    cost_t cost;
+
+    _scratch.init( 0, channel, -1 );
+    _scratch.setToggle( toggle );
+    set( _scratch, message );
+
+    cost.frames = _scratch.repeatsForever() ? rounds : transmitter_c::channel_c::maximumRepeats();
+    cost.airtime = cost.frames * _scratch.airtime();
+
+    return cost;
+  }
+
+  /*
+    Cheapest Single-Output message which changes one output from current to target.
+    Full forward/backward repeat forever and would never make way for a following message: they are only candidates
+    for the last message of a plan, which holds for the given rounds (0: another message follows).
+  */
+  optimizer_c::cost_t optimizer_c::planOutput( transmitter_c::channel_t channel, transmitter_c::singleOutput_t output,
+                                               transmitter_c::pwmOutput_t current, transmitter_c::pwmOutput_t target,
+                                               bool toggle, unsigned int rounds, message_t& message )
+  {
+    message_t candidate;
+    cost_t    best;
+    cost_t    candidateCost;
+
+    message.kind = KIND_SINGLE_OUTPUT_PWM;
+    message.output = output;
+    message.valueA = target;
+    message.valueB = 0;
+    best = cost( channel, message, toggle, rounds );
+
+    candidate.kind = KIND_SINGLE_OUTPUT_CSTID;
+    candidate.output = output;
+    candidate.valueB = 0;
+
+    if ( current != transmitter_c::PWM_OUTPUT_BRAKE_FLOAT && target != transmitter_c::PWM_OUTPUT_BRAKE_FLOAT &&
+         ( step( target ) == step( current ) + 1 || step( target ) == step( current ) - 1 ) )
+    {
+      candidate.valueA = step( target ) > step( current ) ? transmitter_c::SINGLE_OUTPUT_CSTID_INCREMENT_PWM
+                                                          : transmitter_c::SINGLE_OUTPUT_CSTID_DECREMENT_PWM;
+      candidateCost = cost( channel, candidate, toggle, rounds );
+      if ( cheaper( candidateCost, best ) )
+      {
+        message = candidate;
+        best = candidateCost;
+      }
+    }
+
+    if ( rounds > 0 && ( target == transmitter_c::PWM_OUTPUT_FORWARD_7 || target == transmitter_c::PWM_OUTPUT_BACKWARD_7 ) )
+    {
+      candidate.valueA = target == transmitter_c::PWM_OUTPUT_FORWARD_7 ? transmitter_c::SINGLE_OUTPUT_CSTID_FULL_FORWARD
+                                                                       : transmitter_c::SINGLE_OUTPUT_CSTID_FULL_BACKWARD;
+      candidateCost = cost( channel, candidate, toggle, rounds );
+      if ( cheaper( candidateCost, best ) )
+      {
+        message = candidate;
+        best = candidateCost;
+      }
+    }
+
+    return best;
+  }
+
+  /*
+    Update the believed state of the receiver with a message which was handed to the transmitter
+  */
+  void optimizer_c::apply( channelState_t& state, const message_t& message ) const
+  {
+    transmitter_c::pwmOutput_t& output = message.output == transmitter_c::SINGLE_OUTPUT_A ? state.outputA : state.outputB;
+
+    switch ( message.kind )
+    {
+    case KIND_COMBO_DIRECT:
+    case KIND_COMBO_PWM:
+      state.outputA = state.targetA;
+      state.outputB = state.targetB;
+      break;
+
+    case KIND_SINGLE_OUTPUT_CSTID:
+      switch ( message.valueA )
+      {
+      case transmitter_c::SINGLE_OUTPUT_CSTID_INCREMENT_PWM:
+        output = pwm( step( output ) + 1 );
+        break;
+
+      case transmitter_c::SINGLE_OUTPUT_CSTID_DECREMENT_PWM:
+        output = pwm( step( output ) - 1 );
+        break;
+
+      case transmitter_c::SINGLE_OUTPUT_CSTID_FULL_FORWARD:
+        output = transmitter_c::PWM_OUTPUT_FORWARD_7;
+        break;
+
+      case transmitter_c::SINGLE_OUTPUT_CSTID_FULL_BACKWARD:
+        output = transmitter_c::PWM_OUTPUT_BACKWARD_7;
+        break;
+      }
+      break;
+
+    case KIND_SINGLE_OUTPUT_PWM:
+      output = transmitter_c::pwmOutput_t( message.valueA );
+      break;
+    }
+
+    // The receiver times out outputs set by Combo or full forward/backward messages, they are kept by repeating
+    state.continuous = message.kind == KIND_COMBO_DIRECT || message.kind == KIND_COMBO_PWM ||
+                       ( message.kind == KIND_SINGLE_OUTPUT_CSTID &&
+                         ( message.valueA == transmitter_c::SINGLE_OUTPUT_CSTID_FULL_FORWARD ||
+                           message.valueA == transmitter_c::SINGLE_OUTPUT_CSTID_FULL_BACKWARD ) );
+    state.known = true;
+  }
+
+  /*
+    Set the desired outputs of a channel and plan the messages to get there.
+    A plan which is still pending is replaced.
+    The toggle-bit is part of the frame and changes its airtime: candidates are measured with the toggle-bit the
+    transmitter will use, the baseline with the toggle-bit of a channel which only ever sent Combo-PWM.
+    Only the last Single-Output message may repeat forever, the first one has to be sent all its repeats.
+  */
+  void optimizer_c::setOutputs( transmitter_c::channel_t channel, transmitter_c::pwmOutput_t outputA,
+                                transmitter_c::pwmOutput_t outputB )
+  {
+    channelState_t& state = _channels[ channel ];
+
+    if ( state.known && outputA == state.targetA && outputB == state.targetB )
+    {
+      return;
+    }
+
+    const transmitter_c::channel_c&    transmitterChannel = _transmitter._channels[ channel ];
+    const bool                         setBoth = !state.known || state.continuous;
+    const bool                         toggle = transmitterChannel.idle() || transmitterChannel.repeatsForever()
+                                                  ? transmitterChannel.toggle()
+                                                  : !transmitterChannel.toggle();
+    transmitter_c::comboDirectOutput_t directA;
+    transmitter_c::comboDirectOutput_t directB;
+    message_t                          messages[ MESSAGE_NUM ];
+    unsigned int                       messageNum = 0;
+    cost_t                             best;
+
+    messages[ 0 ].kind = KIND_COMBO_PWM;
+    messages[ 0 ].output = 0;
+    messages[ 0 ].valueA = outputA;
+    messages[ 0 ].valueB = outputB;
+    messageNum = 1;
+    best = cost( channel, messages[ 0 ], toggle, _holdRounds );
+    state.baseline = cost( channel, messages[ 0 ], false, 1 ).airtime;
+
+    if ( comboDirect( outputA, directA ) && comboDirect( outputB, directB ) )
+    {
+      message_t message;
+      message.kind = KIND_COMBO_DIRECT;
+      message.output = 0;
+      message.valueA = directA;
+      message.valueB = directB;
+
+      const cost_t messageCost = cost( channel, message, toggle, _holdRounds );
+      if ( cheaper( messageCost, best ) )
+      {
+        messages[ 0 ] = message;
+        messageNum = 1;
+        best = messageCost;
+      }
+    }
+
+    // Single-Output messages, one per output which changes
+    {
+      const bool   changeA = setBoth || outputA != state.outputA;
+      const bool   changeB = setBoth || outputB != state.outputB;
+      message_t    single[ MESSAGE_NUM ];
+      unsigned int singleNum = 0;
+      cost_t       singleCost = { 0, 0 };
+      bool         singleToggle = toggle;
+
+      if ( changeA )
+      {
+        const cost_t outputCost = planOutput( channel, transmitter_c::SINGLE_OUTPUT_A, setBoth ? outputA : state.outputA,
+                                              outputA, singleToggle, changeB ? 0 : _holdRounds, single[ singleNum ] );
+        singleCost.frames += outputCost.frames;
+        singleCost.airtime += outputCost.airtime;
+        singleToggle = !singleToggle;
+        singleNum++;
+      }
+
+      if ( changeB )
+      {
+        const cost_t outputCost =
+          planOutput( channel, transmitter_c::SINGLE_OUTPUT_B, setBoth ? outputB : state.outputB, outputB, singleToggle,
+                      singleCost.frames < _holdRounds ? _holdRounds - singleCost.frames : 1, single[ singleNum ] );
+        singleCost.frames += outputCost.frames;
+        singleCost.airtime += outputCost.airtime;
+        singleNum++;
+      }
+
+      if ( singleNum > 0 && cheaper( singleCost, best ) )
+      {
+        for ( unsigned int message = 0; message < singleNum; message++ )
+        {
+          messages[ message ] = single[ message ];
+        }
+        messageNum = singleNum;
+        best = singleCost;
+      }
+    }
+
+    for ( unsigned int message = 0; message < messageNum; message++ )
+    {
+      state.messages[ message ] = messages[ message ];
+    }
+    state.next = 0;
+    state.pending = messageNum;
+    state.targetA = outputA;
+    state.targetB = outputB;
+  }
+
+  /*
+    Hand the next planned message of every channel to the transmitter and count the airtime of the round.
+    A message is only replaced after all its repeats were sent, unless it repeats forever.
+  */
+  void optimizer_c::update()
+  {
+    for ( int channel = transmitter_c::CHANNEL_1; channel < transmitter_c::CHANNEL_NUM; channel++ )
+    {
+      channelState_t&           state = _channels[ channel ];
+      transmitter_c::channel_c& transmitterChannel = _transmitter._channels[ channel ];
+
+      if ( state.pending > 0 && ( transmitterChannel.idle() || transmitterChannel.repeatsForever() ) )
+      {
+        const message_t& message = state.messages[ state.next ];
+
+        set( transmitterChannel, message );
+        apply( state, message );
+
+        state.next++;
+        if ( state.next >= state.pending )
+        {
+          state.next = 0;
+          state.pending = 0;
+        }
+      }
+
+      // The next sendMessages() sends a frame of every channel which isn't idle
+      if ( !transmitterChannel.idle() )
+      {
+        _airtime += transmitterChannel.airtime();
+      }
+      _baselineAirtime += state.baseline;
+    }
+  }
+}
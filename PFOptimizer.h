@@ -0,0 +1,90 @@
+#ifndef PF_OPTIMIZER_H
+#define PF_OPTIMIZER_H
+
+#include "PFTransmitter.h"
+
+namespace PF_n
+{
+  /*
+    Chooses the messages with the fewest frames and least airtime which bring both outputs of a channel into the
+    desired state: Combo-PWM, Combo-Direct or Single-Output messages (absolute PWM, increment/decrement, full
+    forward/backward).
+    Frames are counted over holdRounds rounds of sendMessages(): a message which the transmitter repeats until the
+    next message costs a frame per round until it is replaced, all others are sent maximumRepeats() times.
+    Single-Output messages set both outputs if the state of the receiver is unknown or was set by a message the
+    receiver times out (Combo, full forward/backward).
+    Call update() before every sendMessages(), it also counts the airtime of the frames the round sends.
+  */
+  class optimizer_c
+  {
+  public:
+    optimizer_c( transmitter_c&, unsigned int = 25 );
+
+    unsigned long airtime() const;
+    long          savedAirtime() const;
+    void          setOutputs( transmitter_c::channel_t, transmitter_c::pwmOutput_t, transmitter_c::pwmOutput_t );
+    void          update();
+
+  private:
+    enum kind_t
+    {
+      KIND_COMBO_DIRECT        = 0,
+      KIND_COMBO_PWM           = 1,
+      KIND_SINGLE_OUTPUT_CSTID = 2,
+      KIND_SINGLE_OUTPUT_PWM   = 3
+    };
+
+    enum
+    {
+      MESSAGE_NUM = 2
+    };
+
+    struct message_t
+    {
+      kind_t       kind;
+      unsigned int output;
+      unsigned int valueA;
+      unsigned int valueB;
+    };
+
+    struct cost_t
+    {
+      unsigned long frames;
+      unsigned long airtime;
+    };
+
+    struct channelState_t
+    {
+      unsigned long              baseline;
+      bool                       continuous;
+      bool                       known;
+      message_t                  messages[ MESSAGE_NUM ];
+      unsigned int               next;
+      transmitter_c::pwmOutput_t outputA;
+      transmitter_c::pwmOutput_t outputB;
+      unsigned int               pending;
+      transmitter_c::pwmOutput_t targetA;
+      transmitter_c::pwmOutput_t targetB;
+    };
+
+    static bool                       cheaper( const cost_t&, const cost_t& );
+    static bool                       comboDirect( transmitter_c::pwmOutput_t, transmitter_c::comboDirectOutput_t& );
+    static transmitter_c::pwmOutput_t pwm( int );
+    static void                       set( transmitter_c::channel_c&, const message_t& );
+    static int                        step( transmitter_c::pwmOutput_t );
+
+    void   apply( channelState_t&, const message_t& ) const;
+    cost_t cost( transmitter_c::channel_t, const message_t&, bool, unsigned int );
+    cost_t planOutput( transmitter_c::channel_t, transmitter_c::singleOutput_t, transmitter_c::pwmOutput_t,
+                       transmitter_c::pwmOutput_t, bool, unsigned int, message_t& );
+
+    unsigned long            _airtime;
+    unsigned long            _baselineAirtime;
+    channelState_t           _channels[ transmitter_c::CHANNEL_NUM ];
+    unsigned int             _holdRounds;
+    transmitter_c::channel_c _scratch;
+    transmitter_c&           _transmitter;
+  };
+}
+
+#endif
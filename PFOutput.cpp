@@ -0,0 +1,62 @@
+#include "PFOutput.h"
+
+#include <Arduino.h>
+
+namespace PF_n
+{
+  /*
+    Get length of a carrier cycle (microseconds)
+  */
+  unsigned int output_c::cycleLength()
+  {
+    return 26;
+  }
+
+  /*
+    Check if marks and spaces are sent later than mark() and space() return (then the IR-receiver can't be sampled
+    for listen before talk)
+  */
+  bool output_c::queued() const
+  {
+    return false;
+  }
+
+  /*
+    Constructor
+  */
+  bitBangOutput_c::bitBangOutput_c( int pin ) :
+    _pin( pin )
+  {
+  }
+
+  /*
+    Send carrier (cycles)
+  */
+  void bitBangOutput_c::mark( unsigned int cycles )
+  {
+    static unsigned int halfCycleLength = cycleLength() / 2;
+
+    for ( unsigned int cycle = 0; cycle < cycles; cycle++ )
+    {
+      digitalWrite( _pin, HIGH );
+      delayMicroseconds( halfCycleLength );
+      digitalWrite( _pin, LOW );
+      delayMicroseconds( halfCycleLength );
+    }
+  }
+
+  /*
+    Wait without carrier (microseconds)
+  */
+  void bitBangOutput_c::space( unsigned long waitTime )
+  {
+    // delayMicroseconds() is only exact up to 16383 us
+    while ( waitTime > 16000 )
+    {
+      delayMicroseconds( 16000 );
+      waitTime -= 16000;
+    }
+
+    delayMicroseconds( waitTime );
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef PF_OUTPUT_H
+#define PF_OUTPUT_H
+
+namespace PF_n
+{
+  /*
+    Output of the IR-signal.
+    A message is written as a sequence of marks (carrier on) and spaces (carrier off).
+  */
+  class output_c
+  {
+  public:
+    static unsigned int cycleLength();
+
+    virtual void mark( unsigned int ) = 0;
+    virtual bool queued() const;
+    virtual void space( unsigned long ) = 0;
+  };
+
+  /*
+    Carrier toggled by software, waiting by busy loops
+  */
+  class bitBangOutput_c : public output_c
+  {
+  public:
+    bitBangOutput_c( int );
+
+    virtual void mark( unsigned int );
+    virtual void space( unsigned long );
+
+  private:
+    int _pin;
+  };
+}
+
+#endif
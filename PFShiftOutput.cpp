@@ -0,0 +1,246 @@
+// The Arduino IDE builds and links every source of the library, so on other targets this file is empty and only
+// including PFShiftOutput.h fails. The interrupt handler is defined by PF_SHIFT_OUTPUT_ISR() in the sketch.
+#if defined( __AVR_ATmega328P__ ) || defined( __AVR_ATmega168__ ) || !defined( ARDUINO )
+
+#include "PFShiftOutput.h"
+
+#if defined( __AVR_ATmega328P__ ) || defined( __AVR_ATmega168__ )
+#define PF_SHIFT_OUTPUT_USART
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+namespace
+{
+  PF_n::shiftOutput_c* activeOutput = 0;
+}
+#endif
+
+namespace PF_n
+{
+  /*
+    Constructor
+  */
+  shiftOutput_c::shiftOutput_c( unsigned long sampleRate ) :
+    _head( 0 ),
+    _initialized( false ),
+    _position( 0 ),
+    _sampleRate( sampleRate ),
+    _tail( 0 )
+  {
+  }
+
+  /*
+    Get sample rate of the hardware (two samples per carrier cycle)
+  */
+  unsigned long shiftOutput_c::defaultSampleRate()
+  {
+#if defined( PF_SHIFT_OUTPUT_USART )
+    return F_CPU / 2 / ( F_CPU / 2 / 76000 );
+#else
+    return 76000;
+#endif
+  }
+
+  /*
+    Shift register of the USART is empty (called by PF_SHIFT_OUTPUT_ISR())
+  */
+  void shiftOutput_c::interrupt()
+  {
+#if defined( PF_SHIFT_OUTPUT_USART )
+    UDR0 = activeOutput->render();
+
+    if ( activeOutput->empty() )
+    {
+      UCSR0B &= ~_BV( UDRIE0 );
+    }
+#endif
+  }
+
+  /*
+    Get number of free entries in the queue
+  */
+  unsigned int shiftOutput_c::available() const
+  {
+    return ( _tail + RUN_NUM - _head - 1 ) % RUN_NUM;
+  }
+
+  /*
+    Initialize hardware
+  */
+  void shiftOutput_c::begin()
+  {
+#if defined( PF_SHIFT_OUTPUT_USART )
+    activeOutput = this;
+
+    // Sequence from the datasheet: baud rate 0 while enabling master SPI mode, XCK is output
+    UBRR0 = 0;
+    pinMode( 4, OUTPUT );
+    UCSR0C = _BV( UMSEL01 ) | _BV( UMSEL00 );
+    UCSR0B = _BV( TXEN0 );
+    UBRR0 = F_CPU / 2 / _sampleRate - 1;
+
+    set_sleep_mode( SLEEP_MODE_IDLE );
+#endif
+
+    _initialized = true;
+  }
+
+  /*
+    Marks and spaces are sent later than mark() and space() return
+  */
+  bool shiftOutput_c::queued() const
+  {
+    return true;
+  }
+
+  /*
+    Get number of queue entries a round of four messages needs at most: 18 marks and 18 spaces per message, the
+    padding and the pause after the round are added to the last space
+  */
+  unsigned int shiftOutput_c::roundRuns()
+  {
+    return 4 * ( 18 + 18 );
+  }
+
+  /*
+    Check if all samples were rendered
+  */
+  bool shiftOutput_c::empty() const
+  {
+    return _tail == _head;
+  }
+
+  /*
+    Queue carrier (cycles)
+  */
+  void shiftOutput_c::mark( unsigned int cycles )
+  {
+    push( RUN_MARK, 2UL * cycles );
+  }
+
+  /*
+    Queue samples, waits if the queue is full.
+    A space is added to a space at the end of the queue, so padding and pauses don't need entries of their own.
+  */
+  void shiftOutput_c::push( unsigned int mark, unsigned long samples )
+  {
+    if ( !_initialized )
+    {
+      begin();
+    }
+
+    if ( mark == 0 && samples > 0 )
+    {
+#if defined( PF_SHIFT_OUTPUT_USART )
+      // The interrupt may render the last entry, it must not see half of the update
+      const unsigned char sreg = SREG;
+      cli();
+#endif
+      if ( _tail != _head )
+      {
+        const unsigned char last = ( _head + RUN_NUM - 1 ) % RUN_NUM;
+        const unsigned int  run = _runs[ last ];
+
+        if ( ( run & RUN_MARK ) == 0 && ( run & RUN_SAMPLES ) < RUN_SAMPLES )
+        {
+          const unsigned int room = RUN_SAMPLES - ( run & RUN_SAMPLES );
+          const unsigned int chunk = samples < room ? samples : static_cast< unsigned long >( room );
+
+          _runs[ last ] = run + chunk;
+          samples -= chunk;
+        }
+      }
+#if defined( PF_SHIFT_OUTPUT_USART )
+      SREG = sreg;
+#endif
+    }
+
+    while ( samples > 0 )
+    {
+      const unsigned int  chunk = samples < RUN_SAMPLES ? samples : static_cast< unsigned long >( RUN_SAMPLES );
+      const unsigned char next = ( _head + 1 ) % RUN_NUM;
+
+      while ( next == _tail )
+      {
+        waitForRoom();
+      }
+
+      _runs[ _head ] = mark | chunk;
+      _head = next;
+      start();
+
+      samples -= chunk;
+    }
+  }
+
+  /*
+    Render the next eight samples (first sample in the most significant bit).
+    Called by the interrupt, zeros if the queue is empty.
+  */
+  unsigned char shiftOutput_c::render()
+  {
+    unsigned char result = 0;
+
+    for ( unsigned char bit = 0x80; bit != 0 && _tail != _head; bit >>= 1 )
+    {
+      const unsigned int run = _runs[ _tail ];
+
+      if ( ( run & RUN_MARK ) != 0 && ( _position & 1 ) == 0 )
+      {
+        result |= bit;
+      }
+
+      if ( ++_position >= ( run & RUN_SAMPLES ) )
+      {
+        _position = 0;
+        _tail = ( _tail + 1 ) % RUN_NUM;
+      }
+    }
+
+    return result;
+  }
+
+  /*
+    Get number of samples per second
+  */
+  unsigned long shiftOutput_c::sampleRate() const
+  {
+    return _sampleRate;
+  }
+
+  /*
+    Queue pause (microseconds)
+  */
+  void shiftOutput_c::space( unsigned long waitTime )
+  {
+    push( 0, ( waitTime * ( _sampleRate / 100 ) + 5000 ) / 10000 );
+  }
+
+  /*
+    Start interrupt which refills the shift register
+  */
+  void shiftOutput_c::start()
+  {
+#if defined( PF_SHIFT_OUTPUT_USART )
+    UCSR0B |= _BV( UDRIE0 );
+#endif
+  }
+
+  /*
+    Queue is full, wait until the interrupt rendered the oldest entry.
+    Without hardware (host build) the samples are dropped, a subclass may collect them instead.
+  */
+  void shiftOutput_c::waitForRoom()
+  {
+#if defined( PF_SHIFT_OUTPUT_USART )
+    sleep_mode();
+#else
+    render();
+#endif
+  }
+}
+
+#endif
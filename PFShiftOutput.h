@@ -0,0 +1,79 @@
+#ifndef PF_SHIFT_OUTPUT_H
+#define PF_SHIFT_OUTPUT_H
+
+#include "PFOutput.h"
+
+#if defined( ARDUINO ) && !defined( __AVR_ATmega328P__ ) && !defined( __AVR_ATmega168__ )
+#error "shiftOutput_c needs the USART of an ATmega328P or ATmega168"
+#endif
+
+/*
+  Interrupt handler of shiftOutput_c, expand it once in the sketch (outside of any function).
+  The library doesn't define it itself, the vector is the one of Serial (HardwareSerial), so sketches which don't use
+  shiftOutput_c can use Serial.
+*/
+#if defined( __AVR_ATmega328P__ ) || defined( __AVR_ATmega168__ )
+#include <avr/interrupt.h>
+
+#define PF_SHIFT_OUTPUT_ISR() \
+  ISR( USART_UDRE_vect )      \
+  {                           \
+    PF_n::shiftOutput_c::interrupt(); \
+  }
+#else
+#define PF_SHIFT_OUTPUT_ISR()
+#endif
+
+namespace PF_n
+{
+  /*
+    Marks and spaces are queued and rendered into a bitstream with two samples per carrier cycle, which is shifted
+    out by hardware. The CPU only refills the shift register from an interrupt, so the timing is as exact as the
+    crystal.
+    On ATmega328P the USART runs in master SPI mode, the IR-LED is connected to TXD (pin 1) and XCK (pin 4) is used as
+    clock; the sketch must contain PF_SHIFT_OUTPUT_ISR() and can't use Serial.
+    A round of sendMessages() fits into the queue: call it when available() >= roundRuns() and it doesn't wait.
+    Listen before talk is disabled, the receiver can't be sampled while the queued messages are on air.
+  */
+  class shiftOutput_c : public output_c
+  {
+  public:
+    shiftOutput_c( unsigned long = defaultSampleRate() );
+
+    static unsigned long defaultSampleRate();
+    static void          interrupt();
+    static unsigned int  roundRuns();
+
+    unsigned int  available() const;
+    bool          empty() const;
+    virtual void  mark( unsigned int );
+    virtual bool  queued() const;
+    unsigned char render();
+    unsigned long sampleRate() const;
+    virtual void  space( unsigned long );
+
+  protected:
+    virtual void waitForRoom();
+
+  private:
+    enum
+    {
+      RUN_NUM     = 160,
+      RUN_MARK    = 0x8000,
+      RUN_SAMPLES = 0x7FFF
+    };
+
+    void begin();
+    void push( unsigned int, unsigned long );
+    void start();
+
+    volatile unsigned char _head;
+    bool                   _initialized;
+    unsigned int           _position;
+    volatile unsigned int  _runs[ RUN_NUM ];
+    unsigned long          _sampleRate;
+    volatile unsigned char _tail;
+  };
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "PFSleepOutput.h"
+
+#if defined( __AVR__ )
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#if defined( TCCR2A ) && defined( OCR2B ) && defined( TIMSK1 )
+
+namespace
+{
+  // Frequency of the carrier
+  const unsigned long carrierFrequency = 38000;
+
+  // Timer1 runs with prescaler 8
+  const unsigned long ticksPerMicrosecond = F_CPU / 8000000UL;
+
+  // Longest wait of Timer1 (16 bit)
+  const unsigned long maximumWait = 30000;
+
+  volatile bool timerExpired = false;
+}
+
+namespace PF_n
+{
+  /*
+    Constructor
+  */
+  sleepOutput_c::sleepOutput_c() :
+    _initialized( false )
+  {
+  }
+
+  /*
+    Timer1 reached the end of a mark or space (called by PF_SLEEP_OUTPUT_ISR())
+  */
+  void sleepOutput_c::interrupt()
+  {
+    timerExpired = true;
+  }
+
+  /*
+    Get pin of the IR-LED (OC2B)
+  */
+  int sleepOutput_c::pin()
+  {
+#if defined( __AVR_ATmega1280__ ) || defined( __AVR_ATmega2560__ )
+    return 9;
+#else
+    return 3;
+#endif
+  }
+
+  /*
+    Initialize timers (not in the constructor, the Arduino core initializes the timers after global objects)
+  */
+  void sleepOutput_c::begin()
+  {
+    pinMode( pin(), OUTPUT );
+    digitalWrite( pin(), LOW );
+
+    // Timer2: CTC, no prescaler, OC2B is connected during marks only
+    TCCR2A = _BV( WGM21 );
+    TCCR2B = _BV( CS20 );
+    OCR2A = F_CPU / 2 / carrierFrequency - 1;
+    OCR2B = 0;
+
+    // Timer1: CTC, prescaler 8
+    TCCR1A = 0;
+    TCCR1B = _BV( WGM12 ) | _BV( CS11 );
+
+    set_sleep_mode( SLEEP_MODE_IDLE );
+
+    _initialized = true;
+  }
+
+  /*
+    Send carrier (cycles)
+  */
+  void sleepOutput_c::mark( unsigned int cycles )
+  {
+    if ( !_initialized )
+    {
+      begin();
+    }
+
+    TCNT2 = 0;
+    TCCR2A |= _BV( COM2B0 );
+    wait( static_cast< unsigned long >( cycles ) * cycleLength() );
+    TCCR2A &= ~_BV( COM2B0 );
+  }
+
+  /*
+    Wait without carrier (microseconds)
+  */
+  void sleepOutput_c::space( unsigned long waitTime )
+  {
+    if ( !_initialized )
+    {
+      begin();
+    }
+
+    wait( waitTime );
+  }
+
+  /*
+    Sleep until Timer1 expired
+  */
+  void sleepOutput_c::wait( unsigned long waitTime )
+  {
+    while ( waitTime > 0 )
+    {
+      const unsigned long chunk = waitTime < maximumWait ? waitTime : maximumWait;
+
+      noInterrupts();
+      timerExpired = false;
+      OCR1A = chunk * ticksPerMicrosecond - 1;
+      TCNT1 = 0;
+      TIFR1 = _BV( OCF1A );
+      TIMSK1 |= _BV( OCIE1A );
+
+      // Other interrupts (e.g. millis()) wake up the CPU as well
+      while ( !timerExpired )
+      {
+        sleep_enable();
+        interrupts();
+        sleep_cpu(); // executed before a pending interrupt, so the wake up can't get lost
+        sleep_disable();
+        noInterrupts();
+      }
+
+      TIMSK1 &= ~_BV( OCIE1A );
+      interrupts();
+
+      waitTime -= chunk;
+    }
+  }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PF_SLEEP_OUTPUT_H
+#define PF_SLEEP_OUTPUT_H
+
+#include "PFOutput.h"
+
+#if defined( __AVR__ )
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif
+
+/*
+  Interrupt handler of sleepOutput_c, expand it once in the sketch (outside of any function).
+  The library doesn't define it itself, so sketches which don't use sleepOutput_c can use Timer1 (e.g. Servo).
+*/
+#if defined( __AVR__ ) && defined( TCCR2A ) && defined( OCR2B ) && defined( TIMSK1 )
+#define PF_SLEEP_OUTPUT_ISR() \
+  ISR( TIMER1_COMPA_vect )    \
+  {                           \
+    PF_n::sleepOutput_c::interrupt(); \
+  }
+#else
+#define PF_SLEEP_OUTPUT_ISR()
+#endif
+
+namespace PF_n
+{
+  /*
+    Carrier generated by Timer2 on pin OC2B (pin 3 on Uno, pin 9 on Mega), marks and spaces timed by Timer1.
+    The CPU sleeps (idle mode) while waiting, the IR-LED must be connected to OC2B.
+    Only available on AVR and only with PF_SLEEP_OUTPUT_ISR() in the sketch. Once used, Timer1 and Timer2 can't be
+    used for anything else (e.g. Servo, tone()).
+  */
+  class sleepOutput_c : public output_c
+  {
+  public:
+    sleepOutput_c();
+
+    static void interrupt();
+    static int  pin();
+
+    virtual void mark( unsigned int );
+    virtual void space( unsigned long );
+
+  private:
+    void begin();
+    void wait( unsigned long );
+
+    bool _initialized;
+  };
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "PFTrace.h"
+
+#if defined( PF_TRACE_ENABLED )
+
+#if !defined( ARDUINO )
+#include <chrono>
+#endif
+
+namespace PF_n
+{
+  trace_c::entry_t trace_c::_entries[ PF_TRACE_SIZE ];
+  unsigned int     trace_c::_next = 0;
+  unsigned int     trace_c::_size = 0;
+
+  /*
+    Forget all events
+  */
+  void trace_c::clear()
+  {
+#if defined( __ARM_ARCH_7M__ ) || defined( __ARM_ARCH_7EM__ )
+    // Enable DWT cycle counter (DEMCR.TRCENA, DWT_CTRL.CYCCNTENA)
+    *reinterpret_cast< volatile unsigned long* >( 0xE000EDFC ) |= 1UL << 24;
+    *reinterpret_cast< volatile unsigned long* >( 0xE0001000 ) |= 1UL;
+#endif
+
+    _next = 0;
+    _size = 0;
+  }
+
+  /*
+    Get an event, the oldest first
+  */
+  const trace_c::entry_t& trace_c::entry( unsigned int index )
+  {
+    return _entries[ ( _next + PF_TRACE_SIZE - _size + index ) % PF_TRACE_SIZE ];
+  }
+
+  /*
+    Get time stamp of host builds (nanoseconds)
+  */
+  unsigned long trace_c::hostClock()
+  {
+#if defined( ARDUINO )
+    return 0;
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+      std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+  }
+
+  /*
+    Get number of recorded events
+  */
+  unsigned int trace_c::size()
+  {
+    return _size;
+  }
+
+#if defined( ARDUINO )
+  /*
+    Print all events ("event time" per line) and forget them
+  */
+  void trace_c::dump( Print& output )
+  {
+    output.print( F( "# ticks/us " ) );
+    output.println( PF_TRACE_TICKS_PER_MICROSECOND );
+
+    for ( unsigned int index = 0; index < _size; index++ )
+    {
+      output.print( entry( index ).event );
+      output.print( ' ' );
+      output.println( entry( index ).time );
+    }
+
+    clear();
+  }
+#endif
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef PF_TRACE_H
+#define PF_TRACE_H
+
+/*
+  Trace points of the transmit path.
+  With PF_TRACE_ENABLED defined (here or as compiler flag) every trace point records its event and a time stamp into
+  a ring buffer, which is printed by trace_c::dump() after sending. Otherwise the trace points produce no code.
+  Every mark is only traced with PF_TRACE_MARKS defined as well. The default size holds one round of sendMessages()
+  with messages on all channels: 10 events per message, 36 more with marks.
+*/
+// #define PF_TRACE_ENABLED
+// #define PF_TRACE_MARKS
+
+#if defined( PF_TRACE_ENABLED ) && !defined( PF_TRACE_SIZE )
+#if defined( PF_TRACE_MARKS )
+#define PF_TRACE_SIZE 192
+#else
+#define PF_TRACE_SIZE 64
+#endif
+#endif
+
+#if defined( PF_TRACE_ENABLED ) && !defined( PF_TRACE_CLOCK )
+#if defined( __ARM_ARCH_7M__ ) || defined( __ARM_ARCH_7EM__ )
+// DWT cycle counter, enabled by trace_c::clear()
+#define PF_TRACE_CLOCK()                 ( *reinterpret_cast< volatile unsigned long* >( 0xE0001004 ) )
+#define PF_TRACE_TICKS_PER_MICROSECOND   ( F_CPU / 1000000UL )
+#elif defined( ARDUINO )
+#define PF_TRACE_CLOCK()                 micros()
+#define PF_TRACE_TICKS_PER_MICROSECOND   1
+#else
+#define PF_TRACE_CLOCK()                 PF_n::trace_c::hostClock()
+#define PF_TRACE_TICKS_PER_MICROSECOND   1000
+#endif
+#endif
+
+#if defined( PF_TRACE_ENABLED )
+#define PF_TRACE( event ) PF_n::trace_c::record( PF_n::trace_c::event )
+#else
+#define PF_TRACE( event )
+#endif
+
+#if defined( PF_TRACE_ENABLED ) && defined( PF_TRACE_MARKS )
+#define PF_TRACE_MARK( event ) PF_TRACE( event )
+#else
+#define PF_TRACE_MARK( event )
+#endif
+
+#if defined( PF_TRACE_ENABLED ) && defined( ARDUINO )
+#include <Arduino.h>
+#endif
+
+namespace PF_n
+{
+  class trace_c
+  {
+  public:
+    enum event_t
+    {
+      EVENT_SEND_BEGIN    = 0,
+      EVENT_SEND_END      = 1,
+      EVENT_LBT_BEGIN     = 2,
+      EVENT_LBT_END       = 3,
+      EVENT_ENCODE_BEGIN  = 4,
+      EVENT_ENCODE_END    = 5,
+      EVENT_NIBBLES_BEGIN = 6,
+      EVENT_NIBBLES_END   = 7,
+      EVENT_MARK_BEGIN    = 8,
+      EVENT_MARK_END      = 9,
+      EVENT_PADDING_BEGIN = 10,
+      EVENT_PADDING_END   = 11,
+      EVENT_NUM           = 12
+    };
+
+#if defined( PF_TRACE_ENABLED )
+    struct entry_t
+    {
+      unsigned char event;
+      unsigned long time;
+    };
+
+    static void           clear();
+    static const entry_t& entry( unsigned int );
+    static unsigned long  hostClock();
+    static unsigned int   size();
+
+#if defined( ARDUINO )
+    static void dump( Print& );
+#endif
+
+    /*
+      Record an event
+    */
+    static inline void record( event_t event )
+    {
+      entry_t& entry = _entries[ _next ];
+
+      entry.event = event;
+      entry.time = PF_TRACE_CLOCK();
+      // No modulo, PF_TRACE_SIZE needn't be a power of two and a division takes ~200 cycles on AVR
+      if ( ++_next == PF_TRACE_SIZE )
+      {
+        _next = 0;
+      }
+      if ( _size < PF_TRACE_SIZE )
+      {
+        _size++;
+      }
+    }
+
+  private:
+    static entry_t      _entries[ PF_TRACE_SIZE ];
+    static unsigned int _next;
+    static unsigned int _size;
+#endif
+  };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "PFTransmitter.h"
+#include "PFTrace.h"
 
 #include <Arduino.h>
 
@@ -10,11 +11,15 @@ namespace PF_n
   transmitter_c::channel_c::channel_c() :
     _actualMessageLength( 0 ),
     _channel( CHANNEL_NUM ),
+    _collided( false ),
+    _collisions( 0 ),
     _data( 0 ),
+    _deferrals( 0 ),
     _mode( MODE_NONE ),
-    _pin( -1 ),
+    _output( 0 ),
     _outputA( PWM_OUTPUT_FLOAT ),
     _outputB( PWM_OUTPUT_FLOAT ),
+    _receiverPin( -1 ),
     _repeats( 0 ),
     _singleOutput( SINGLE_OUTPUT_A ),
     _singleOutputMode( SINGLE_OUTPUT_MODE_PWM ),
@@ -25,10 +30,35 @@ namespace PF_n
   /*
     Initialize values
   */
-  void transmitter_c::channel_c::init( int pin, channel_t channel )
+  void transmitter_c::channel_c::init( output_c* output, channel_t channel, int receiverPin )
   {
     _channel = channel;
-    _pin = pin;
+    _output = output;
+    _receiverPin = receiverPin;
+  }
+
+  /*
+    Check if a channel still repeats a message which isn't repeated forever, a new message would cut it short
+  */
+  bool transmitter_c::busy( channel_t channel ) const
+  {
+    return !_channels[ channel ].idle() && !_channels[ channel ].repeatsForever();
+  }
+
+  /*
+    Get number of messages which were disturbed by another transmitter
+  */
+  unsigned long transmitter_c::channel_c::collisions() const
+  {
+    return _collisions;
+  }
+
+  /*
+    Get number of messages which were deferred because another transmitter was sending
+  */
+  unsigned long transmitter_c::channel_c::deferrals() const
+  {
+    return _deferrals;
   }
 
   /*
@@ -36,7 +66,7 @@ namespace PF_n
   */
   unsigned int transmitter_c::channel_c::cycleLength()
   {
-    return 26;
+    return output_c::cycleLength();
   }
 
   /*
@@ -47,6 +77,113 @@ namespace PF_n
     return 16000;
   }
 
+  /*
+    Get time without carrier after which no message is on air.
+    This is longer than the longest pause inside a message (start/stop bit).
+  */
+  unsigned int transmitter_c::channel_c::idleTime()
+  {
+    return ( 39 + 6 ) * cycleLength();
+  }
+
+  /*
+    Get maximum number of deferrals before a message is sent anyway
+  */
+  unsigned int transmitter_c::channel_c::maximumDeferrals()
+  {
+    return 4;
+  }
+
+  /*
+    Get random backoff (in messages) of a deferral: 1 to the spacing of the repeats in the specification, 5 * tm for
+    the first two and (6 + 2 * Ch) * tm, Ch = 1..4, for the others.
+    The window grows with the channel number, so transmitters on different channels drift apart instead of colliding
+    again.
+  */
+  unsigned int transmitter_c::channel_c::backoffSlots( unsigned int deferral ) const
+  {
+    const unsigned int window = deferral < 2 ? 5 : 6 + 2 * ( _channel + 1 );
+
+    return random( 1, window + 1 );
+  }
+
+  /*
+    Check if the IR-receiver sees a carrier (the output of the receiver is active low)
+  */
+  bool transmitter_c::channel_c::carrierDetected() const
+  {
+    return digitalRead( _receiverPin ) == LOW;
+  }
+
+  /*
+    Wait until no other message is on air.
+    Blocks sendMessages() for at most the four backoff windows (26 * tm on channel 1 to 38 * tm on channel 4) and
+    four waits for an idle room of up to 2 * tm + idleTime() each, about 0.55 to 0.75 s. The other channels of this
+    transmitter aren't refreshed meanwhile.
+  */
+  void transmitter_c::channel_c::listenBeforeTalk()
+  {
+    if ( _receiverPin < 0 )
+    {
+      return;
+    }
+
+    for ( unsigned int deferral = 0; deferral < maximumDeferrals(); deferral++ )
+    {
+      if ( waitForIdle() )
+      {
+        return;
+      }
+
+      // Count a message once, however often it backs off
+      if ( deferral == 0 )
+      {
+        _deferrals++;
+      }
+
+      _output->space( static_cast< unsigned long >( backoffSlots( deferral ) ) * maximumMessageLength() );
+    }
+  }
+
+  /*
+    Wait until the carrier was absent for idleTime().
+    Returns false if a carrier was detected.
+  */
+  bool transmitter_c::channel_c::waitForIdle() const
+  {
+    bool          idle = true;
+    unsigned long idleSince = micros();
+    unsigned long busySince = idleSince;
+
+    while ( micros() - idleSince < idleTime() )
+    {
+      if ( carrierDetected() )
+      {
+        idle = false;
+        idleSince = micros();
+        if ( idleSince - busySince > 2UL * maximumMessageLength() )
+        {
+          // permanent carrier (e.g. sunlight), don't wait any longer
+          break;
+        }
+      }
+      delayMicroseconds( cycleLength() );
+    }
+
+    return idle;
+  }
+
+  /*
+    Check for a carrier of another transmitter at the end of a long pause
+  */
+  void transmitter_c::channel_c::senseCollision() const
+  {
+    if ( _receiverPin >= 0 && carrierDetected() )
+    {
+      _collided = true;
+    }
+  }
+
   /*
     Wait (cycles)
   */
@@ -60,7 +197,7 @@ namespace PF_n
   */
   void transmitter_c::channel_c::pauseTime( unsigned int waitTime ) const
   {
-    delayMicroseconds( waitTime );
+    _output->space( waitTime );
     _actualMessageLength += waitTime;
   }
 
@@ -69,39 +206,117 @@ namespace PF_n
   */
   void transmitter_c::channel_c::sendMessage()
   {
-    _actualMessageLength = 0;
+    PF_TRACE( EVENT_SEND_BEGIN );
 
     if ( _mode != MODE_NONE )
     {
-      for ( int nibble = NIBBLE_1; nibble < NIBBLE_NUM; nibble++ )
-      {
-        _nibbles[ nibble ] = 0;
-      }
+      PF_TRACE( EVENT_LBT_BEGIN );
+      listenBeforeTalk();
+      PF_TRACE( EVENT_LBT_END );
+    }
 
+    _actualMessageLength = 0;
+    _collided = false;
+
+    if ( _mode != MODE_NONE )
+    {
       writeStartStopBit();
-      writeToggle();
-      writeEscape();
-      writeChannel();
-      if ( _mode == MODE_COMBO_PWM )
-      {
-        writePwmOutput();
-      }
-      else
-      {
-        writeAddress();
-        writeMode();
-        writeData();
-      }
-      writeLRC();
+      PF_TRACE( EVENT_ENCODE_BEGIN );
+      encode();
+      PF_TRACE( EVENT_ENCODE_END );
       
+      PF_TRACE( EVENT_NIBBLES_BEGIN );
       writeNibbles();
+      PF_TRACE( EVENT_NIBBLES_END );
 
       writeStartStopBit();
+
+      if ( _collided )
+      {
+        _collisions++;
+      }
     }
 
+    PF_TRACE( EVENT_PADDING_BEGIN );
     pauseTime( maximumMessageLength() - _actualMessageLength );
+    PF_TRACE( EVENT_PADDING_END );
 
     endMessage();
+
+    PF_TRACE( EVENT_SEND_END );
+  }
+
+  /*
+    Calculate all nibbles of the message
+  */
+  void transmitter_c::channel_c::encode() const
+  {
+    for ( int nibble = NIBBLE_1; nibble < NIBBLE_NUM; nibble++ )
+    {
+      _nibbles[ nibble ] = 0;
+    }
+
+    writeToggle();
+    writeEscape();
+    writeChannel();
+    if ( _mode == MODE_COMBO_PWM )
+    {
+      writePwmOutput();
+    }
+    else
+    {
+      writeAddress();
+      writeMode();
+      writeData();
+    }
+    writeLRC();
+  }
+
+  /*
+    Get time the message is on air (without padding)
+  */
+  unsigned int transmitter_c::channel_c::airtime() const
+  {
+    unsigned int cycles = 2 * ( 6 + 39 ); // start and stop bit
+
+    encode();
+
+    for ( int nibble = NIBBLE_1; nibble < NIBBLE_NUM; nibble++ )
+    {
+      for ( int bit = 3; bit >= 0; bit-- )
+      {
+        cycles += ( _nibbles[ nibble ] & ( 1 << bit ) ) > 0 ? 6 + 21 : 6 + 10;
+      }
+    }
+
+    return cycles * cycleLength();
+  }
+
+  /*
+    Check if no message is set
+  */
+  bool transmitter_c::channel_c::idle() const
+  {
+    return _mode == MODE_NONE;
+  }
+
+  /*
+    Get number of times a message is sent (unless it is repeated until the next message)
+  */
+  unsigned int transmitter_c::channel_c::maximumRepeats()
+  {
+    return 5;
+  }
+
+  /*
+    Check if the message is sent again and again until the next message is set
+  */
+  bool transmitter_c::channel_c::repeatsForever() const
+  {
+    return _mode == MODE_COMBO_PWM ||
+           _mode == MODE_COMBO_DIRECT ||
+           ( _mode == MODE_SINGLE_OUTPUT && _singleOutputMode == SINGLE_OUTPUT_MODE_CSTID &&
+             ( _data == SINGLE_OUTPUT_CSTID_FULL_FORWARD || _data == SINGLE_OUTPUT_CSTID_FULL_BACKWARD ) );
   }
 
   /*
@@ -109,16 +324,18 @@ namespace PF_n
   */
   void transmitter_c::channel_c::endMessage()
   {
-    if ( _mode == MODE_COMBO_PWM ||
-         _mode == MODE_COMBO_DIRECT ||
-         ( _mode == MODE_SINGLE_OUTPUT && ( _data == SINGLE_OUTPUT_CSTID_FULL_FORWARD || _data == SINGLE_OUTPUT_CSTID_FULL_BACKWARD ) ) )
+    if ( idle() )
+    {
+      // Nothing was sent, the next message is repeated maximumRepeats() times
+    }
+    else if ( repeatsForever() )
     {
       // Send message again in next cycle
     }
     else
     {
       _repeats++;
-      if ( _repeats >= 5 )
+      if ( _repeats >= maximumRepeats() )
       {
         _mode = MODE_NONE;
         _toggle = !_toggle;
@@ -127,6 +344,22 @@ namespace PF_n
     }
   }
 
+  /*
+    Set toggle-bit of the next message
+  */
+  void transmitter_c::channel_c::setToggle( bool toggle )
+  {
+    _toggle = toggle;
+  }
+
+  /*
+    Get toggle-bit of the next message, it changes after a message which isn't repeated forever
+  */
+  bool transmitter_c::channel_c::toggle() const
+  {
+    return _toggle;
+  }
+
   /*
     Set a message for Combo-Direct-Mode
   */
@@ -233,9 +466,9 @@ namespace PF_n
   */
   void transmitter_c::channel_c::writeHighBit() const
   {
-//    Serial.println( "High" );
     writeMark();
     pauseCycles( 21 );
+    senseCollision();
   }
 
   /*
@@ -243,7 +476,6 @@ namespace PF_n
   */
   void transmitter_c::channel_c::writeLowBit() const
   {
-//    Serial.println( "Low" );
     writeMark();
     pauseCycles( 10 );
   }
@@ -253,9 +485,9 @@ namespace PF_n
   */
   void transmitter_c::channel_c::writeStartStopBit() const
   {
-//    Serial.println( "Start/Stop" );
     writeMark();
     pauseCycles( 39 ); 
+    senseCollision();
   }
 
   /*
@@ -263,15 +495,10 @@ namespace PF_n
   */
   void transmitter_c::channel_c::writeMark() const
   {
-    static unsigned int halfCycleLength = cycleLength() / 2;
-
-    for ( int xx = 0; xx < 6; xx++ )
-    {
-      digitalWrite( _pin, HIGH );
-      pauseTime( halfCycleLength );
-      digitalWrite( _pin, LOW );
-      pauseTime( halfCycleLength );
-    }
+    PF_TRACE_MARK( EVENT_MARK_BEGIN );
+    _output->mark( 6 );
+    _actualMessageLength += 6 * cycleLength();
+    PF_TRACE_MARK( EVENT_MARK_END );
   }
 
   /*
@@ -310,7 +537,6 @@ namespace PF_n
   {
     for ( int nibble = NIBBLE_1; nibble < NIBBLE_NUM; nibble++ )
     {
-//      Serial.println( _nibbles[ nibble ] );
       for ( int bit = 3; bit >= 0; bit-- )
       {
         if ( ( _nibbles[ nibble ] & ( 1 << bit ) ) > 0 )
@@ -348,13 +574,68 @@ namespace PF_n
   /*
     Constructor
   */
-  transmitter_c::transmitter_c( int pin ) :
-    _pin( pin )
+  transmitter_c::transmitter_c( int pin, int receiverPin ) :
+    _bitBangOutput( pin ),
+    _output( &_bitBangOutput )
   {
-    _channels[ CHANNEL_1 ].init( pin, CHANNEL_1 );
-    _channels[ CHANNEL_2 ].init( pin, CHANNEL_2 );
-    _channels[ CHANNEL_3 ].init( pin, CHANNEL_3 );
-    _channels[ CHANNEL_4 ].init( pin, CHANNEL_4 );
+    init( receiverPin );
+  }
+
+  /*
+    Constructor (with another output, e.g. sleepOutput_c)
+  */
+  transmitter_c::transmitter_c( output_c& output, int receiverPin ) :
+    _bitBangOutput( -1 ),
+    _output( &output )
+  {
+    init( receiverPin );
+  }
+
+  /*
+    Initialize channels
+  */
+  void transmitter_c::init( int receiverPin )
+  {
+    // A queued output sends later, the receiver would be sampled at the wrong time
+    if ( _output->queued() )
+    {
+      receiverPin = -1;
+    }
+
+    _channels[ CHANNEL_1 ].init( _output, CHANNEL_1, receiverPin );
+    _channels[ CHANNEL_2 ].init( _output, CHANNEL_2, receiverPin );
+    _channels[ CHANNEL_3 ].init( _output, CHANNEL_3, receiverPin );
+    _channels[ CHANNEL_4 ].init( _output, CHANNEL_4, receiverPin );
+  }
+
+  /*
+    Get number of messages which were disturbed by another transmitter
+  */
+  unsigned long transmitter_c::collisions() const
+  {
+    unsigned long result = 0;
+
+    for ( int channel = CHANNEL_1; channel <= CHANNEL_4; channel++ )
+    {
+      result += _channels[ channel ].collisions();
+    }
+
+    return result;
+  }
+
+  /*
+    Get number of messages which were deferred because another transmitter was sending
+  */
+  unsigned long transmitter_c::deferrals() const
+  {
+    unsigned long result = 0;
+
+    for ( int channel = CHANNEL_1; channel <= CHANNEL_4; channel++ )
+    {
+      result += _channels[ channel ].deferrals();
+    }
+
+    return result;
   }
 
   /*
@@ -393,7 +674,7 @@ namespace PF_n
     {
       _channels[ channel ].sendMessage();
     }
-    delay( tm );
+    _output->space( tm * 1000UL );
 #endif
   }
 
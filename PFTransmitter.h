@@ -1,8 +1,12 @@
 #ifndef PF_TRANSMITTER_H
 #define PF_TRANSMITTER_H
 
+#include "PFOutput.h"
+
 namespace PF_n
 {
+  class optimizer_c;
+
   class transmitter_c
   {
   public:
@@ -109,9 +113,15 @@ namespace PF_n
     public:
       channel_c();
 
+      unsigned int        airtime() const;
       static unsigned int cycleLength();
-      void                init( int, channel_t );
+      unsigned long       collisions() const;
+      unsigned long       deferrals() const;
+      bool                idle() const;
+      void                init( output_c*, channel_t, int );
       static unsigned int maximumMessageLength();
+      static unsigned int maximumRepeats();
+      bool                repeatsForever() const;
       void                sendMessage();
       void                setMessageComboDirect( comboDirectOutput_t, comboDirectOutput_t );
       void                setMessageComboPWM( pwmOutput_t, pwmOutput_t );
@@ -119,55 +129,79 @@ namespace PF_n
       void                setMessageSingleOutputCstid( singleOutput_t, singleOutputCstid_t );
       void                setMessageSingleOutputPWM( singleOutput_t, pwmOutput_t );
       void                setMode( mode_t );
+      void                setToggle( bool );
+      bool                toggle() const;
 
     private:
-      void endMessage();
-      void pauseCycles( unsigned int ) const;
-      void pauseTime( unsigned int ) const;
-      void writeAddress() const;
-      void writeChannel() const;
-      void writeData() const;
-      void writeEscape() const;
-      void writeHighBit() const;
-      void writeLowBit() const;
-      void writeLRC() const;
-      void writeMark() const;
-      void writeMode() const;
-      void writeNibbles() const;
-      void writePwmOutput() const;
-      void writeStartStopBit() const;
-      void writeToggle() const;
+      static unsigned int idleTime();
+      static unsigned int maximumDeferrals();
+
+      unsigned int backoffSlots( unsigned int ) const;
+      bool         carrierDetected() const;
+      void         encode() const;
+      void         endMessage();
+      void         listenBeforeTalk();
+      void         pauseCycles( unsigned int ) const;
+      void         pauseTime( unsigned int ) const;
+      void         senseCollision() const;
+      bool         waitForIdle() const;
+      void         writeAddress() const;
+      void         writeChannel() const;
+      void         writeData() const;
+      void         writeEscape() const;
+      void         writeHighBit() const;
+      void         writeLowBit() const;
+      void         writeLRC() const;
+      void         writeMark() const;
+      void         writeMode() const;
+      void         writeNibbles() const;
+      void         writePwmOutput() const;
+      void         writeStartStopBit() const;
+      void         writeToggle() const;
 
       mutable unsigned int _actualMessageLength;
       channel_t            _channel;
+      mutable bool         _collided;
+      unsigned long        _collisions;
       unsigned int         _data;
+      unsigned long        _deferrals;
       mode_t               _mode;
       mutable unsigned int _nibbles[ NIBBLE_NUM ];
-      int                  _pin;
+      output_c*            _output;
       unsigned int         _outputA;
       unsigned int         _outputB;
+      int                  _receiverPin;
       unsigned int         _repeats;
       singleOutput_t       _singleOutput;
       singleOutputMode_t   _singleOutputMode;
       bool                 _toggle;
     };
 
-  public:
-    transmitter_c( int );
+    friend class optimizer_c;
 
-    void sendMessages();
-    void setMessageComboDirect( channel_t, comboDirectOutput_t, bool, comboDirectOutput_t, bool );
-    void setMessageComboPWM( channel_t, pwmOutput_t, bool, pwmOutput_t, bool );
-    void setMessageExtended( channel_t, extendedData_t );
-    void setMessageSingleOutputCstid( channel_t, singleOutput_t, singleOutputCstid_t );
-    void setMessageSingleOutputPWM( channel_t, singleOutput_t, pwmOutput_t, bool );
+  public:
+    transmitter_c( int, int = -1 );
+    transmitter_c( output_c&, int = -1 );
+
+    bool          busy( channel_t ) const;
+    unsigned long collisions() const;
+    unsigned long deferrals() const;
+    void          sendMessages();
+    void          setMessageComboDirect( channel_t, comboDirectOutput_t, bool, comboDirectOutput_t, bool );
+    void          setMessageComboPWM( channel_t, pwmOutput_t, bool, pwmOutput_t, bool );
+    void          setMessageExtended( channel_t, extendedData_t );
+    void          setMessageSingleOutputCstid( channel_t, singleOutput_t, singleOutputCstid_t );
+    void          setMessageSingleOutputPWM( channel_t, singleOutput_t, pwmOutput_t, bool );
 
   private:
     static comboDirectOutput_t inverseComboDirect( comboDirectOutput_t, bool );
     static pwmOutput_t         inversePwm( pwmOutput_t, bool );
 
-    channel_c _channels[ CHANNEL_NUM ];
-    int       _pin;
+    void init( int );
+
+    bitBangOutput_c _bitBangOutput;
+    channel_c       _channels[ CHANNEL_NUM ];
+    output_c*       _output;
   };
 }
 
@@ -1,11 +1,13 @@
 #include <Arduino.h>
 
+#include <PFInput.h>
 #include <PFTransmitter.h>
 
 namespace
 {
   // Digital
   const int pinIrLed                    = 8;
+  const int pinIrReceiver               = 7;
   const int pinButtonNorth              = 4;
   const int pinButtonSouth              = 5;
   const int pinButtonEast               = 3;
@@ -19,69 +21,18 @@ namespace
   // Analog
   const int pinJoystickX = 0;
   const int pinJoystickY = 1;
+  const int pinNoise     = 2;
 
   const int xLeft  = 0;
   const int xRight = 1023;
   const int yDown  = 1023;
   const int yUp    = 0;
 
-  int xMid = 0;
-  int yMid = 0;
+  const unsigned int joystickDeadband   = 40;
+  const unsigned int joystickHysteresis = 8;
 
-  PF_n::transmitter_c transmitter( pinIrLed );
-
-  /*
-    Get joystick values and send message
-  */
-  void readJoystickComboPWM( PF_n::transmitter_c::channel_t channel, int pinX, int pinY, int xLeft, int xMid, int xRight,
-                             int yUp, int yMid, int yDown )
-  {
-    const int valX = analogRead( pinX );
-    const int valY = analogRead( pinY );
-    PF_n::transmitter_c::pwmOutput_t outputA = PF_n::transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
-    PF_n::transmitter_c::pwmOutput_t outputB = PF_n::transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
-
-    if ( valX < xMid )
-    {
-      // Links
-      outputA = PF_n::transmitter_c::pwmOutput_t( map( valX, xMid, xLeft,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_FLOAT, PF_n::transmitter_c::PWM_OUTPUT_FORWARD_7 ) );
-    }
-    else
-    {
-      // Rechts
-      outputA = PF_n::transmitter_c::pwmOutput_t( map( valX, xMid, xRight,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1 + 1,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_7 ) );
-    }
-    if ( outputA <= PF_n::transmitter_c::PWM_OUTPUT_FLOAT || outputA > PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1 )
-    {
-      outputA = PF_n::transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
-    }
-
-    if ( valY < yMid )
-    {
-      // Vorwärts
-      outputB = PF_n::transmitter_c::pwmOutput_t( map( valY, yMid, yUp,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_FLOAT, PF_n::transmitter_c::PWM_OUTPUT_FORWARD_7 ) );
-    }
-    else
-    {
-      // Rückwärts
-      outputB = PF_n::transmitter_c::pwmOutput_t( map( valY, yMid, yDown,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1 + 1,
-                                                       PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_7 ) );
-    }
-    if ( outputB <=  PF_n::transmitter_c::PWM_OUTPUT_FLOAT || outputB > PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1 )
-    {
-      outputB = PF_n::transmitter_c::PWM_OUTPUT_BRAKE_FLOAT;
-    }
-
-    const bool inverseJoystickX = digitalRead( pinInverseJoystickX ) == HIGH;
-    const bool inverseJoystickY = digitalRead( pinInverseJoystickY ) == HIGH;
-
-    transmitter.setMessageComboPWM( channel, outputA, inverseJoystickX, outputB, inverseJoystickY );
-  }
+  PF_n::transmitter_c transmitter( pinIrLed, pinIrReceiver );
+  PF_n::joystick_c    joystick( transmitter, PF_n::transmitter_c::CHANNEL_1, pinJoystickX, pinJoystickY );
 
   /*
     Get button values and send message
@@ -169,8 +120,12 @@ void setup()
 
   pinMode( pinIrLed, OUTPUT );
 
-  xMid = analogRead( pinJoystickX );
-  yMid = analogRead( pinJoystickY );
+  pinMode( pinIrReceiver, INPUT );
+  digitalWrite( pinIrReceiver, HIGH );
+
+  joystick.calibrate( xLeft, xRight, yUp, yDown, joystickDeadband, joystickHysteresis );
+
+  randomSeed( analogRead( pinNoise ) );
   
   Serial.begin( 9600 );
 }
@@ -192,7 +147,7 @@ void loop()
   delay( 100 );
 */
 
-  readJoystickComboPWM( PF_n::transmitter_c::CHANNEL_1, pinJoystickX, pinJoystickY, xLeft, xMid, xRight, yUp, yMid, yDown );
+  joystick.update( digitalRead( pinInverseJoystickX ) == HIGH, digitalRead( pinInverseJoystickY ) == HIGH );
   readButtons( PF_n::transmitter_c::CHANNEL_2, pinButtonNorth, pinButtonSouth, pinButtonEast, pinButtonWest );
   readJoystickButton( PF_n::transmitter_c::CHANNEL_3, pinButtonJoystick );
 
@@ -0,0 +1,30 @@
+#ifndef PF_HOST_ARDUINO_H
+#define PF_HOST_ARDUINO_H
+
+/*
+  Replacement of the Arduino core for host builds.
+  Every thread which runs library code is bound to a simulated controller (PF_n::host_n::mcu_c),
+  the functions below act on the controller of the calling thread.
+*/
+
+#define LOW          0
+#define HIGH         1
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+void          delay( unsigned long );
+void          delayMicroseconds( unsigned int );
+int           analogRead( int );
+int           digitalRead( int );
+void          digitalWrite( int, int );
+long          map( long, long, long, long, long );
+unsigned long micros();
+unsigned long millis();
+void          pinMode( int, int );
+long          random( long );
+long          random( long, long );
+void          randomSeed( unsigned long );
+
+#endif
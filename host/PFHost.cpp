@@ -0,0 +1,569 @@
+#include "PFHost.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    namespace
+    {
+      // Pause between two bursts of the same mark is half a carrier cycle
+      const unsigned long long markGap = 50000;
+
+      // Receivers can't separate bursts which are closer than this
+      const unsigned long long mergeGap = 100000;
+
+      // Pause between two marks according to the specification (start of mark to start of next mark)
+      const unsigned long long lowMinimum   = 316000;
+      const unsigned long long highMinimum  = 526000;
+      const unsigned long long startMinimum = 947000;
+      const unsigned long long startMaximum = 1579000;
+
+      thread_local mcu_c*  currentMcu = 0;
+      thread_local room_c* currentRoom = 0;
+    }
+
+    /*
+      Constructor
+    */
+    mcu_c::mcu_c( room_c& room, unsigned long seed, double drift, unsigned long long startTime ) :
+      _ledLevel( LOW ),
+      _ledPin( -1 ),
+      _nsPerMicrosecond( 1000.0 * ( 1.0 + drift ) ),
+      _publishedTime( startTime ),
+      _random( seed ),
+      _receiverPin( -1 ),
+      _room( room ),
+      _startTime( startTime ),
+      _time( startTime )
+    {
+      for ( int pin = 0; pin < analogPins; pin++ )
+      {
+        _analogValues[ pin ] = 512;
+      }
+
+      _room.add( *this );
+    }
+
+    /*
+      Get controller of the calling thread
+    */
+    mcu_c& mcu_c::current()
+    {
+      return *currentMcu;
+    }
+
+    /*
+      Bind controller to the calling thread
+    */
+    void mcu_c::activate()
+    {
+      currentMcu = this;
+    }
+
+    /*
+      Read analog input
+    */
+    int mcu_c::analogRead( int pin ) const
+    {
+      return pin >= 0 && pin < analogPins ? _analogValues[ pin ] : 0;
+    }
+
+    /*
+      Check if the IR-LED had a carrier between the given times
+    */
+    bool mcu_c::carrierOn( unsigned long long from, unsigned long long to ) const
+    {
+      std::lock_guard< std::mutex > lock( _marksMutex );
+
+      std::vector< mark_t >::const_iterator mark =
+        std::lower_bound( _marks.begin(), _marks.end(), to,
+                          []( const mark_t& left, unsigned long long right ) { return left.start < right; } );
+
+      return mark != _marks.begin() && ( mark - 1 )->end >= from;
+    }
+
+    /*
+      Wait (microseconds of the controller clock)
+    */
+    void mcu_c::delayMicroseconds( unsigned long waitTime )
+    {
+      _time += static_cast< unsigned long long >( std::llround( waitTime * _nsPerMicrosecond ) );
+      _publishedTime.store( _time );
+      _room.publish();
+    }
+
+    /*
+      Read digital input; the IR-receiver is active low
+    */
+    int mcu_c::digitalRead( int pin )
+    {
+      if ( pin == _receiverPin && _room.carrierDetected( _time, _visible ) )
+      {
+        return LOW;
+      }
+
+      return HIGH;
+    }
+
+    /*
+      Write digital output
+    */
+    void mcu_c::digitalWrite( int pin, int level )
+    {
+      if ( pin != _ledPin || level == _ledLevel )
+      {
+        return;
+      }
+
+      std::lock_guard< std::mutex > lock( _marksMutex );
+
+      if ( level == HIGH && ( _marks.empty() || _time > _marks.back().end + markGap ) )
+      {
+        mark_t mark = { _time, _time };
+        _marks.push_back( mark );
+      }
+      else
+      {
+        _marks.back().end = _time;
+      }
+
+      _ledLevel = level;
+    }
+
+    /*
+      Controller won't do anything else, nobody has to wait for it
+    */
+    void mcu_c::finish()
+    {
+      _publishedTime.store( ~0ULL );
+      _room.publish();
+    }
+
+    /*
+      Get all marks sent by the controller
+    */
+    std::vector< mark_t > mcu_c::marks() const
+    {
+      std::lock_guard< std::mutex > lock( _marksMutex );
+
+      return _marks;
+    }
+
+    /*
+      Get controller time (microseconds)
+    */
+    unsigned long mcu_c::micros() const
+    {
+      return static_cast< unsigned long >( ( _time - _startTime ) / _nsPerMicrosecond );
+    }
+
+    /*
+      Get random number in [min, max)
+    */
+    long mcu_c::random( long min, long max )
+    {
+      if ( min >= max )
+      {
+        return min;
+      }
+
+      return std::uniform_int_distribution< long >( min, max - 1 )( _random );
+    }
+
+    /*
+      Initialize random numbers
+    */
+    void mcu_c::randomSeed( unsigned long seed )
+    {
+      _random.seed( seed );
+    }
+
+    /*
+      Set value of an analog input
+    */
+    void mcu_c::setAnalogValue( int pin, int value )
+    {
+      if ( pin >= 0 && pin < analogPins )
+      {
+        _analogValues[ pin ] = value;
+      }
+    }
+
+    /*
+      Set pin of the IR-LED
+    */
+    void mcu_c::setLedPin( int pin )
+    {
+      _ledPin = pin;
+    }
+
+    /*
+      Set pin of the IR-receiver
+    */
+    void mcu_c::setReceiverPin( int pin )
+    {
+      _receiverPin = pin;
+    }
+
+    /*
+      Set the controllers whose IR-LED the IR-receiver sees (default, or empty: all in the room)
+    */
+    void mcu_c::setVisible( const std::vector< mcu_c* >& visible )
+    {
+      _visible = visible;
+    }
+
+    /*
+      Get room time (nanoseconds)
+    */
+    unsigned long long mcu_c::time() const
+    {
+      return _publishedTime.load();
+    }
+
+    /*
+      Constructor
+    */
+    room_c::room_c( unsigned int holdTime ) :
+      _current( 0 ),
+      _holdTime( holdTime * 1000ULL ),
+      _waiters( 0 )
+    {
+    }
+
+    /*
+      Add a controller (before any controller is started)
+    */
+    void room_c::add( mcu_c& mcu )
+    {
+      _mcus.push_back( &mcu );
+    }
+
+    /*
+      Check if any of the visible IR-LEDs (empty: all in the room) has a carrier at the given time.
+      Waits until these controllers reached this time, so the result doesn't depend on thread scheduling.
+    */
+    bool room_c::carrierDetected( unsigned long long time, const std::vector< mcu_c* >& visible )
+    {
+      const std::vector< mcu_c* >& mcus = visible.empty() ? _mcus : visible;
+
+      for ( std::vector< mcu_c* >::const_iterator mcu = mcus.begin(); mcu != mcus.end(); ++mcu )
+      {
+        if ( !_fibers.empty() )
+        {
+          while ( ( *mcu )->time() < time )
+          {
+            swapcontext( &_fibers[ _current ].context, &_scheduler );
+          }
+        }
+        else if ( ( *mcu )->time() < time )
+        {
+          std::unique_lock< std::mutex > lock( _mutex );
+
+          _waiters++;
+          _changed.wait( lock, [ mcu, time ] { return ( *mcu )->time() >= time; } );
+          _waiters--;
+        }
+      }
+
+      const unsigned long long from = time > _holdTime ? time - _holdTime : 0;
+
+      for ( std::vector< mcu_c* >::const_iterator mcu = mcus.begin(); mcu != mcus.end(); ++mcu )
+      {
+        if ( ( *mcu )->carrierOn( from, time ) )
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    /*
+      Wake up controllers which wait for others
+    */
+    void room_c::publish()
+    {
+      if ( _waiters.load() > 0 )
+      {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _changed.notify_all();
+      }
+    }
+
+    /*
+      Run the programs of all controllers (in the order they were added) in the calling thread.
+      The controller with the lowest time runs until it has to wait for another, it can't wait itself.
+    */
+    void room_c::run( const std::vector< std::function< void() > >& programs )
+    {
+      // Contexts must not move after makecontext(), so the vector is never resized while running
+      _fibers = std::vector< fiber_t >( std::min( programs.size(), _mcus.size() ) );
+
+      for ( size_t fiber = 0; fiber < _fibers.size(); fiber++ )
+      {
+        _fibers[ fiber ].finished = false;
+        _fibers[ fiber ].program = programs[ fiber ];
+        _fibers[ fiber ].stack.resize( stackSize );
+
+        getcontext( &_fibers[ fiber ].context );
+        _fibers[ fiber ].context.uc_stack.ss_sp = &_fibers[ fiber ].stack[ 0 ];
+        _fibers[ fiber ].context.uc_stack.ss_size = stackSize;
+        _fibers[ fiber ].context.uc_link = &_scheduler;
+        makecontext( &_fibers[ fiber ].context, startFiber, 0 );
+      }
+
+      room_c* const outerRoom = currentRoom;
+      mcu_c* const  outerMcu = currentMcu;
+
+      currentRoom = this;
+
+      while ( true )
+      {
+        size_t next = _fibers.size();
+
+        for ( size_t fiber = 0; fiber < _fibers.size(); fiber++ )
+        {
+          if ( !_fibers[ fiber ].finished && ( next == _fibers.size() || _mcus[ fiber ]->time() < _mcus[ next ]->time() ) )
+          {
+            next = fiber;
+          }
+        }
+
+        if ( next == _fibers.size() )
+        {
+          break;
+        }
+
+        _current = next;
+        _mcus[ next ]->activate();
+        swapcontext( &_scheduler, &_fibers[ next ].context );
+      }
+
+      currentRoom = outerRoom;
+      currentMcu = outerMcu;
+      _fibers.clear();
+    }
+
+    /*
+      Entry of a controller started by run()
+    */
+    void room_c::startFiber()
+    {
+      room_c* const room = currentRoom;
+
+      room->_fibers[ room->_current ].program();
+      room->_fibers[ room->_current ].finished = true;
+    }
+
+    /*
+      Constructor
+    */
+    scheduleOutput_c::scheduleOutput_c() :
+      _calls( 0 )
+    {
+    }
+
+    /*
+      Add to schedule, consecutive pulses of the same kind are combined
+    */
+    void scheduleOutput_c::add( bool mark, unsigned long duration )
+    {
+      _calls++;
+
+      if ( !_pulses.empty() && _pulses.back().mark == mark )
+      {
+        _pulses.back().duration += duration;
+      }
+      else
+      {
+        pulse_t pulse = { mark, duration };
+        _pulses.push_back( pulse );
+      }
+    }
+
+    /*
+      Get number of calls of mark() and space()
+    */
+    unsigned long scheduleOutput_c::calls() const
+    {
+      return _calls;
+    }
+
+    /*
+      Forget recorded schedule
+    */
+    void scheduleOutput_c::clear()
+    {
+      _calls = 0;
+      _pulses.clear();
+    }
+
+    /*
+      Record carrier (cycles)
+    */
+    void scheduleOutput_c::mark( unsigned int cycles )
+    {
+      add( true, cycles * cycleLength() );
+    }
+
+    /*
+      Get recorded schedule
+    */
+    const std::vector< pulse_t >& scheduleOutput_c::pulses() const
+    {
+      return _pulses;
+    }
+
+    /*
+      Record pause (microseconds)
+    */
+    void scheduleOutput_c::space( unsigned long waitTime )
+    {
+      add( false, waitTime );
+    }
+
+    /*
+      Decode all complete messages with a valid checksum
+    */
+    std::vector< frame_t > receiver_c::decode( const std::vector< mark_t >& marks )
+    {
+      std::vector< frame_t > frames;
+      size_t                 first = 0;
+
+      while ( first + 17 < marks.size() )
+      {
+        frame_t frame = { marks[ first ].start, { 0, 0, 0, 0 } };
+        bool    valid = true;
+
+        for ( size_t bit = 0; bit < 17 && valid; bit++ )
+        {
+          const unsigned long long pause = marks[ first + bit + 1 ].start - marks[ first + bit ].start;
+
+          if ( bit == 0 )
+          {
+            valid = pause >= startMinimum && pause < startMaximum;
+          }
+          else if ( pause >= lowMinimum && pause < startMinimum )
+          {
+            frame.nibbles[ ( bit - 1 ) / 4 ] = ( frame.nibbles[ ( bit - 1 ) / 4 ] << 1 ) | ( pause >= highMinimum ? 1 : 0 );
+          }
+          else
+          {
+            valid = false;
+          }
+        }
+
+        if ( valid && ( frame.nibbles[ 0 ] ^ frame.nibbles[ 1 ] ^ frame.nibbles[ 2 ] ^ frame.nibbles[ 3 ] ) == 0xF )
+        {
+          frames.push_back( frame );
+          first += 18;
+        }
+        else
+        {
+          first++;
+        }
+      }
+
+      return frames;
+    }
+
+    /*
+      Combine marks of several IR-LEDs as seen by one receiver
+    */
+    std::vector< mark_t > receiver_c::merge( const std::vector< std::vector< mark_t > >& sources )
+    {
+      std::vector< mark_t > all;
+
+      for ( std::vector< std::vector< mark_t > >::const_iterator source = sources.begin(); source != sources.end(); ++source )
+      {
+        all.insert( all.end(), source->begin(), source->end() );
+      }
+
+      std::sort( all.begin(), all.end(), []( const mark_t& left, const mark_t& right ) { return left.start < right.start; } );
+
+      std::vector< mark_t > result;
+
+      for ( std::vector< mark_t >::const_iterator mark = all.begin(); mark != all.end(); ++mark )
+      {
+        if ( !result.empty() && mark->start <= result.back().end + mergeGap )
+        {
+          result.back().end = std::max( result.back().end, mark->end );
+        }
+        else
+        {
+          result.push_back( *mark );
+        }
+      }
+
+      return result;
+    }
+  }
+}
+
+/*
+  Arduino core, forwarded to the controller of the calling thread
+*/
+void delay( unsigned long waitTime )
+{
+  PF_n::host_n::mcu_c::current().delayMicroseconds( waitTime * 1000 );
+}
+
+void delayMicroseconds( unsigned int waitTime )
+{
+  PF_n::host_n::mcu_c::current().delayMicroseconds( waitTime );
+}
+
+int analogRead( int pin )
+{
+  return PF_n::host_n::mcu_c::current().analogRead( pin );
+}
+
+int digitalRead( int pin )
+{
+  return PF_n::host_n::mcu_c::current().digitalRead( pin );
+}
+
+void digitalWrite( int pin, int level )
+{
+  PF_n::host_n::mcu_c::current().digitalWrite( pin, level );
+}
+
+long map( long value, long fromLow, long fromHigh, long toLow, long toHigh )
+{
+  return ( value - fromLow ) * ( toHigh - toLow ) / ( fromHigh - fromLow ) + toLow;
+}
+
+unsigned long micros()
+{
+  return PF_n::host_n::mcu_c::current().micros();
+}
+
+unsigned long millis()
+{
+  return PF_n::host_n::mcu_c::current().micros() / 1000;
+}
+
+void pinMode( int, int )
+{
+}
+
+long random( long max )
+{
+  return PF_n::host_n::mcu_c::current().random( 0, max );
+}
+
+long random( long min, long max )
+{
+  return PF_n::host_n::mcu_c::current().random( min, max );
+}
+
+void randomSeed( unsigned long seed )
+{
+  PF_n::host_n::mcu_c::current().randomSeed( seed );
+}
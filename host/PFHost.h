@@ -0,0 +1,167 @@
+#ifndef PF_HOST_H
+#define PF_HOST_H
+
+#include <PFOutput.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <ucontext.h>
+#include <vector>
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    /*
+      Carrier burst of an IR-LED (room time in nanoseconds)
+    */
+    struct mark_t
+    {
+      unsigned long long start;
+      unsigned long long end;
+    };
+
+    /*
+      Decoded message
+    */
+    struct frame_t
+    {
+      unsigned long long time;
+      unsigned int       nibbles[ 4 ];
+    };
+
+    /*
+      Mark or space of a recorded schedule (microseconds)
+    */
+    struct pulse_t
+    {
+      bool          mark;
+      unsigned long duration;
+    };
+
+    class room_c;
+
+    /*
+      Simulated controller.
+      Library code runs in its own thread, which is bound to the controller by activate().
+      Time only advances by delays, the clock of the controller runs with the given drift.
+    */
+    class mcu_c
+    {
+    public:
+      mcu_c( room_c&, unsigned long, double = 0.0, unsigned long long = 0 );
+
+      static mcu_c& current();
+
+      void                  activate();
+      int                   analogRead( int ) const;
+      bool                  carrierOn( unsigned long long, unsigned long long ) const;
+      void                  delayMicroseconds( unsigned long );
+      int                   digitalRead( int );
+      void                  digitalWrite( int, int );
+      void                  finish();
+      std::vector< mark_t > marks() const;
+      unsigned long         micros() const;
+      long                  random( long, long );
+      void                  randomSeed( unsigned long );
+      void                  setAnalogValue( int, int );
+      void                  setLedPin( int );
+      void                  setReceiverPin( int );
+      void                  setVisible( const std::vector< mcu_c* >& );
+      unsigned long long    time() const;
+
+    private:
+      static const int analogPins = 8;
+
+      int                               _analogValues[ analogPins ];
+      int                               _ledLevel;
+      int                               _ledPin;
+      std::vector< mark_t >             _marks;
+      mutable std::mutex                _marksMutex;
+      double                            _nsPerMicrosecond;
+      std::atomic< unsigned long long > _publishedTime;
+      std::mt19937                      _random;
+      int                               _receiverPin;
+      room_c&                           _room;
+      unsigned long long                _startTime;
+      unsigned long long                _time;
+      std::vector< mcu_c* >             _visible;
+    };
+
+    /*
+      Room shared by several controllers.
+      A receiver sees a carrier up to holdTime after the last burst of any IR-LED it sees.
+      Controllers either run in their own threads, or all in the calling thread by run(): then a controller which
+      waits for the others switches to the one furthest behind by swapcontext(), without futex waits or thread
+      switches. glibc's swapcontext() still saves the signal mask with a system call (rt_sigprocmask) per switch.
+    */
+    class room_c
+    {
+    public:
+      room_c( unsigned int = 200 );
+
+      void add( mcu_c& );
+      bool carrierDetected( unsigned long long, const std::vector< mcu_c* >& );
+      void publish();
+      void run( const std::vector< std::function< void() > >& );
+
+    private:
+      static const size_t stackSize = 128 * 1024;
+
+      struct fiber_t
+      {
+        ucontext_t              context;
+        bool                    finished;
+        std::function< void() > program;
+        std::vector< char >     stack;
+      };
+
+      static void startFiber();
+
+      std::condition_variable _changed;
+      size_t                  _current;
+      std::vector< fiber_t >  _fibers;
+      unsigned long long      _holdTime;
+      std::vector< mcu_c* >   _mcus;
+      std::mutex              _mutex;
+      ucontext_t              _scheduler;
+      std::atomic< int >      _waiters;
+    };
+
+    /*
+      Output which records marks and spaces instead of sending them
+    */
+    class scheduleOutput_c : public output_c
+    {
+    public:
+      scheduleOutput_c();
+
+      unsigned long                 calls() const;
+      void                          clear();
+      virtual void                  mark( unsigned int );
+      const std::vector< pulse_t >& pulses() const;
+      virtual void                  space( unsigned long );
+
+    private:
+      void add( bool, unsigned long );
+
+      unsigned long          _calls;
+      std::vector< pulse_t > _pulses;
+    };
+
+    /*
+      Decoder of the Power Functions RC protocol
+    */
+    class receiver_c
+    {
+    public:
+      static std::vector< frame_t > decode( const std::vector< mark_t >& );
+      static std::vector< mark_t >  merge( const std::vector< std::vector< mark_t > >& );
+    };
+  }
+}
+
+#endif
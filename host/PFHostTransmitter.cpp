@@ -0,0 +1,537 @@
+#include "PFHostTransmitter.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Atomics in the shared segment must work without a lock, a lock would be private to each process
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_LONG_LOCK_FREE == 2, "shared control needs lock-free atomics" );
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    /*
+      Constructor
+    */
+    mailbox_c::mailbox_c() :
+      _head( 0 ),
+      _tail( 0 )
+    {
+      for ( unsigned long cell = 0; cell < CELL_NUM; cell++ )
+      {
+        _cells[ cell ].sequence.store( cell, std::memory_order_relaxed );
+      }
+    }
+
+    /*
+      Take the oldest command (worker only)
+    */
+    bool mailbox_c::get( command_t& command )
+    {
+      cell_t& cell = _cells[ _tail % CELL_NUM ];
+
+      if ( cell.sequence.load( std::memory_order_acquire ) != _tail + 1 )
+      {
+        return false;
+      }
+
+      command = cell.command;
+      cell.sequence.store( _tail + CELL_NUM, std::memory_order_release );
+      _tail++;
+
+      return true;
+    }
+
+    /*
+      Put a command, returns false if the mailbox is full
+    */
+    bool mailbox_c::put( const command_t& command )
+    {
+      unsigned long head = _head.load( std::memory_order_relaxed );
+
+      for ( ;; )
+      {
+        cell_t&             cell = _cells[ head % CELL_NUM ];
+        const unsigned long sequence = cell.sequence.load( std::memory_order_acquire );
+
+        if ( sequence == head )
+        {
+          // Cell is free, claim it
+          if ( _head.compare_exchange_weak( head, head + 1, std::memory_order_relaxed ) )
+          {
+            cell.command = command;
+            cell.sequence.store( head + 1, std::memory_order_release );
+            return true;
+          }
+        }
+        else if ( sequence < head )
+        {
+          // Worker didn't take the command of the previous round yet
+          return false;
+        }
+        else
+        {
+          head = _head.load( std::memory_order_relaxed );
+        }
+      }
+    }
+
+    /*
+      Constructor
+    */
+    sharedControl_c::sharedControl_c() :
+      _segment( 0 )
+    {
+    }
+
+    /*
+      Destructor
+    */
+    sharedControl_c::~sharedControl_c()
+    {
+      close();
+    }
+
+    /*
+      Get the last version the transmitter picked up
+    */
+    unsigned long sharedControl_c::applied( transmitter_c::channel_t channel ) const
+    {
+      return _segment != 0 ? static_cast< unsigned long >( _segment->slots[ channel ].applied.load( std::memory_order_acquire ) ) : 0;
+    }
+
+    /*
+      Unmap segment
+    */
+    void sharedControl_c::close()
+    {
+      if ( _segment != 0 )
+      {
+        ::munmap( _segment, sizeof( segment_t ) );
+        _segment = 0;
+      }
+    }
+
+    /*
+      Create and map a new segment (name like "/pf-control"), fails if it already exists
+    */
+    bool sharedControl_c::create( const char* name )
+    {
+      close();
+
+      const int fd = ::shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+
+      if ( fd < 0 )
+      {
+        return false;
+      }
+
+      // New memory is zero: all slots have version 0, nothing was set
+      if ( ::ftruncate( fd, sizeof( segment_t ) ) != 0 || !map( fd ) )
+      {
+        ::close( fd );
+        ::shm_unlink( name );
+        return false;
+      }
+
+      ::close( fd );
+      _segment->magic.store( magic, std::memory_order_release );
+
+      return true;
+    }
+
+    /*
+      Get command and version of a channel, false if it was never set
+    */
+    bool sharedControl_c::get( transmitter_c::channel_t channel, command_t& command, unsigned long& version ) const
+    {
+      if ( _segment == 0 )
+      {
+        return false;
+      }
+
+      const unsigned long long state = _segment->slots[ channel ].state.load( std::memory_order_acquire );
+
+      version = static_cast< unsigned long >( state >> 32 );
+      command.kind = command_t::kind_t( state & 0x7 );
+      command.channel = channel;
+      command.output = ( state >> 3 ) & 0x1;
+      command.valueA = ( state >> 4 ) & 0xF;
+      command.valueB = ( state >> 8 ) & 0xF;
+
+      return version != 0;
+    }
+
+    /*
+      Map an existing file descriptor
+    */
+    bool sharedControl_c::map( int fd )
+    {
+      void* const address = ::mmap( 0, sizeof( segment_t ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+      if ( address == MAP_FAILED )
+      {
+        return false;
+      }
+
+      _segment = static_cast< segment_t* >( address );
+
+      return true;
+    }
+
+    /*
+      Map an existing segment, fails if it isn't initialized yet
+    */
+    bool sharedControl_c::open( const char* name )
+    {
+      close();
+
+      const int   fd = ::shm_open( name, O_RDWR, 0 );
+      struct stat status;
+
+      if ( fd < 0 )
+      {
+        return false;
+      }
+
+      if ( ::fstat( fd, &status ) != 0 || status.st_size < static_cast< off_t >( sizeof( segment_t ) ) || !map( fd ) )
+      {
+        ::close( fd );
+        return false;
+      }
+
+      ::close( fd );
+
+      if ( _segment->magic.load( std::memory_order_acquire ) != magic )
+      {
+        close();
+        return false;
+      }
+
+      return true;
+    }
+
+    /*
+      Replace the command of a channel and count up its version
+    */
+    unsigned long sharedControl_c::post( command_t::kind_t kind, transmitter_c::channel_t channel, unsigned int output,
+                                         unsigned int valueA, unsigned int valueB )
+    {
+      if ( _segment == 0 )
+      {
+        return 0;
+      }
+
+      std::atomic< unsigned long long >& slot = _segment->slots[ channel ].state;
+      const unsigned long long           command = ( kind & 0x7 ) | ( output & 0x1 ) << 3 | ( valueA & 0xF ) << 4 | ( valueB & 0xF ) << 8;
+      unsigned long long                 state = slot.load( std::memory_order_relaxed );
+      unsigned long                      version;
+
+      do
+      {
+        // Version 0 means never set, skip it on wrap around
+        version = static_cast< unsigned long >( ( ( state >> 32 ) + 1 ) & 0xFFFFFFFFUL );
+        if ( version == 0 )
+        {
+          version = 1;
+        }
+      }
+      while ( !slot.compare_exchange_weak( state, static_cast< unsigned long long >( version ) << 32 | command,
+                                           std::memory_order_release, std::memory_order_relaxed ) );
+
+      return version;
+    }
+
+    /*
+      Remove a segment, mappings stay valid until they are closed
+    */
+    bool sharedControl_c::remove( const char* name )
+    {
+      return ::shm_unlink( name ) == 0;
+    }
+
+    /*
+      Record the version the transmitter picked up
+    */
+    void sharedControl_c::setApplied( transmitter_c::channel_t channel, unsigned long version )
+    {
+      if ( _segment != 0 )
+      {
+        _segment->slots[ channel ].applied.store( version, std::memory_order_release );
+      }
+    }
+
+    /*
+      Set a message for Combo-Direct-Mode
+    */
+    unsigned long sharedControl_c::setMessageComboDirect( transmitter_c::channel_t channel, transmitter_c::comboDirectOutput_t outputA,
+                                                          transmitter_c::comboDirectOutput_t outputB )
+    {
+      return post( command_t::KIND_COMBO_DIRECT, channel, 0, outputA, outputB );
+    }
+
+    /*
+      Set a message for Combo-PWM-Mode
+    */
+    unsigned long sharedControl_c::setMessageComboPWM( transmitter_c::channel_t channel, transmitter_c::pwmOutput_t outputA,
+                                                       transmitter_c::pwmOutput_t outputB )
+    {
+      return post( command_t::KIND_COMBO_PWM, channel, 0, outputA, outputB );
+    }
+
+    /*
+      Set a message for Extended-Mode
+    */
+    unsigned long sharedControl_c::setMessageExtended( transmitter_c::channel_t channel, transmitter_c::extendedData_t data )
+    {
+      return post( command_t::KIND_EXTENDED, channel, 0, data, 0 );
+    }
+
+    /*
+      Set a message for Single-Output-CSTID-Mode
+    */
+    unsigned long sharedControl_c::setMessageSingleOutputCstid( transmitter_c::channel_t channel, transmitter_c::singleOutput_t output,
+                                                                transmitter_c::singleOutputCstid_t data )
+    {
+      return post( command_t::KIND_SINGLE_OUTPUT_CSTID, channel, output, data, 0 );
+    }
+
+    /*
+      Set a message for Single-Output-PWM-Mode
+    */
+    unsigned long sharedControl_c::setMessageSingleOutputPWM( transmitter_c::channel_t channel, transmitter_c::singleOutput_t output,
+                                                              transmitter_c::pwmOutput_t data )
+    {
+      return post( command_t::KIND_SINGLE_OUTPUT_PWM, channel, output, data, 0 );
+    }
+
+    /*
+      Constructor
+    */
+    hostTransmitter_c::hostTransmitter_c( output_c& output, sharedControl_c* control ) :
+      _control( control ),
+      _rounds( 0 ),
+      _running( false ),
+      _transmitter( output )
+    {
+      for ( int channel = transmitter_c::CHANNEL_1; channel < transmitter_c::CHANNEL_NUM; channel++ )
+      {
+        _versions[ channel ] = 0;
+      }
+    }
+
+    /*
+      Destructor
+    */
+    hostTransmitter_c::~hostTransmitter_c()
+    {
+      stop();
+    }
+
+    /*
+      Pass a command to the transmitter (worker only)
+    */
+    void hostTransmitter_c::apply( const command_t& command )
+    {
+      switch ( command.kind )
+      {
+      case command_t::KIND_COMBO_DIRECT:
+        _transmitter.setMessageComboDirect( command.channel, transmitter_c::comboDirectOutput_t( command.valueA ), false,
+                                            transmitter_c::comboDirectOutput_t( command.valueB ), false );
+        break;
+
+      case command_t::KIND_COMBO_PWM:
+        _transmitter.setMessageComboPWM( command.channel, transmitter_c::pwmOutput_t( command.valueA ), false,
+                                         transmitter_c::pwmOutput_t( command.valueB ), false );
+        break;
+
+      case command_t::KIND_EXTENDED:
+        _transmitter.setMessageExtended( command.channel, transmitter_c::extendedData_t( command.valueA ) );
+        break;
+
+      case command_t::KIND_SINGLE_OUTPUT_CSTID:
+        _transmitter.setMessageSingleOutputCstid( command.channel, transmitter_c::singleOutput_t( command.output ),
+                                                  transmitter_c::singleOutputCstid_t( command.valueA ) );
+        break;
+
+      case command_t::KIND_SINGLE_OUTPUT_PWM:
+        _transmitter.setMessageSingleOutputPWM( command.channel, transmitter_c::singleOutput_t( command.output ),
+                                                transmitter_c::pwmOutput_t( command.valueA ), false );
+        break;
+      }
+    }
+
+    /*
+      Check if the transmitter repeats the message of a command until the next one
+    */
+    bool hostTransmitter_c::continuous( const command_t& command )
+    {
+      return command.kind == command_t::KIND_COMBO_DIRECT || command.kind == command_t::KIND_COMBO_PWM;
+    }
+
+    /*
+      Put a command into the mailbox
+    */
+    bool hostTransmitter_c::post( command_t::kind_t kind, transmitter_c::channel_t channel, unsigned int output,
+                                  unsigned int valueA, unsigned int valueB )
+    {
+      const command_t command = { kind, channel, output, valueA, valueB };
+
+      return _mailbox.put( command );
+    }
+
+    /*
+      Queue a command taken from the mailbox (worker only)
+    */
+    void hostTransmitter_c::queue( const command_t& command )
+    {
+      if ( continuous( command ) )
+      {
+        for ( std::deque< command_t >::reverse_iterator pending = _pending.rbegin(); pending != _pending.rend(); ++pending )
+        {
+          if ( pending->channel == command.channel )
+          {
+            if ( continuous( *pending ) )
+            {
+              *pending = command;
+              return;
+            }
+            break;
+          }
+        }
+      }
+
+      _pending.push_back( command );
+    }
+
+    /*
+      Get number of rounds sent by the worker
+    */
+    unsigned long hostTransmitter_c::rounds() const
+    {
+      return _rounds.load();
+    }
+
+    /*
+      Worker: pass commands to the transmitter and send
+    */
+    void hostTransmitter_c::run()
+    {
+      command_t     command;
+      unsigned long version;
+
+      while ( _running.load( std::memory_order_relaxed ) )
+      {
+        // A channel is taken by its first command of the round, or by a message which isn't sent completely yet
+        bool taken[ transmitter_c::CHANNEL_NUM ];
+
+        for ( int channel = transmitter_c::CHANNEL_1; channel < transmitter_c::CHANNEL_NUM; channel++ )
+        {
+          taken[ channel ] = _transmitter.busy( transmitter_c::channel_t( channel ) );
+        }
+
+        // The mailbox stays full while too many commands wait, so put() fails instead of queueing without bound
+        while ( _pending.size() < PENDING_NUM && _mailbox.get( command ) )
+        {
+          queue( command );
+        }
+
+        for ( std::deque< command_t >::iterator pending = _pending.begin(); pending != _pending.end(); )
+        {
+          if ( taken[ pending->channel ] )
+          {
+            ++pending;
+          }
+          else
+          {
+            apply( *pending );
+            taken[ pending->channel ] = true;
+            pending = _pending.erase( pending );
+          }
+        }
+
+        for ( int channel = transmitter_c::CHANNEL_1; _control != 0 && channel < transmitter_c::CHANNEL_NUM; channel++ )
+        {
+          if ( !taken[ channel ] && _control->get( transmitter_c::channel_t( channel ), command, version ) &&
+               version != _versions[ channel ] )
+          {
+            apply( command );
+            _versions[ channel ] = version;
+            _control->setApplied( transmitter_c::channel_t( channel ), version );
+          }
+        }
+
+        _transmitter.sendMessages();
+        _rounds++;
+      }
+    }
+
+    /*
+      Set a message for Combo-Direct-Mode
+    */
+    bool hostTransmitter_c::setMessageComboDirect( transmitter_c::channel_t channel, transmitter_c::comboDirectOutput_t outputA,
+                                                   transmitter_c::comboDirectOutput_t outputB )
+    {
+      return post( command_t::KIND_COMBO_DIRECT, channel, 0, outputA, outputB );
+    }
+
+    /*
+      Set a message for Combo-PWM-Mode
+    */
+    bool hostTransmitter_c::setMessageComboPWM( transmitter_c::channel_t channel, transmitter_c::pwmOutput_t outputA,
+                                                transmitter_c::pwmOutput_t outputB )
+    {
+      return post( command_t::KIND_COMBO_PWM, channel, 0, outputA, outputB );
+    }
+
+    /*
+      Set a message for Extended-Mode
+    */
+    bool hostTransmitter_c::setMessageExtended( transmitter_c::channel_t channel, transmitter_c::extendedData_t data )
+    {
+      return post( command_t::KIND_EXTENDED, channel, 0, data, 0 );
+    }
+
+    /*
+      Set a message for Single-Output-CSTID-Mode
+    */
+    bool hostTransmitter_c::setMessageSingleOutputCstid( transmitter_c::channel_t channel, transmitter_c::singleOutput_t output,
+                                                         transmitter_c::singleOutputCstid_t data )
+    {
+      return post( command_t::KIND_SINGLE_OUTPUT_CSTID, channel, output, data, 0 );
+    }
+
+    /*
+      Set a message for Single-Output-PWM-Mode
+    */
+    bool hostTransmitter_c::setMessageSingleOutputPWM( transmitter_c::channel_t channel, transmitter_c::singleOutput_t output,
+                                                       transmitter_c::pwmOutput_t data )
+    {
+      return post( command_t::KIND_SINGLE_OUTPUT_PWM, channel, output, data, 0 );
+    }
+
+    /*
+      Start worker
+    */
+    void hostTransmitter_c::start()
+    {
+      if ( !_running.exchange( true ) )
+      {
+        _worker = std::thread( &hostTransmitter_c::run, this );
+      }
+    }
+
+    /*
+      Stop worker after the current round
+    */
+    void hostTransmitter_c::stop()
+    {
+      if ( _running.exchange( false ) )
+      {
+        _worker.join();
+      }
+    }
+  }
+}
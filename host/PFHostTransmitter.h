@@ -0,0 +1,166 @@
+#ifndef PF_HOST_TRANSMITTER_H
+#define PF_HOST_TRANSMITTER_H
+
+#include <PFTransmitter.h>
+
+#include <atomic>
+#include <deque>
+#include <thread>
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    /*
+      Message for a channel, passed from a control thread to the worker
+    */
+    struct command_t
+    {
+      enum kind_t
+      {
+        KIND_COMBO_DIRECT        = 0,
+        KIND_COMBO_PWM           = 1,
+        KIND_EXTENDED            = 2,
+        KIND_SINGLE_OUTPUT_CSTID = 3,
+        KIND_SINGLE_OUTPUT_PWM   = 4
+      };
+
+      kind_t                   kind;
+      transmitter_c::channel_t channel;
+      unsigned int             output;
+      unsigned int             valueA;
+      unsigned int             valueB;
+    };
+
+    /*
+      Bounded lock-free queue, any number of control threads put commands, one worker takes them
+    */
+    class mailbox_c
+    {
+    public:
+      mailbox_c();
+
+      bool get( command_t& );
+      bool put( const command_t& );
+
+    private:
+      enum
+      {
+        CELL_NUM = 64
+      };
+
+      struct cell_t
+      {
+        std::atomic< unsigned long > sequence;
+        command_t                    command;
+      };
+
+      cell_t                       _cells[ CELL_NUM ];
+      std::atomic< unsigned long > _head;
+      unsigned long                _tail;
+    };
+
+    /*
+      Target state of every channel in a shared memory segment, for several processes controlling one transmitter.
+      A slot holds the version and the packed command in one word: writers replace it lock-free by compare-and-swap,
+      readers get version and command with a single load and never see a torn update.
+      The set-functions return the new version, or 0 if no segment is mapped.
+    */
+    class sharedControl_c
+    {
+    public:
+      sharedControl_c();
+      ~sharedControl_c();
+
+      unsigned long applied( transmitter_c::channel_t ) const;
+      void          close();
+      bool          create( const char* );
+      bool          get( transmitter_c::channel_t, command_t&, unsigned long& ) const;
+      bool          open( const char* );
+      static bool   remove( const char* );
+      void          setApplied( transmitter_c::channel_t, unsigned long );
+      unsigned long setMessageComboDirect( transmitter_c::channel_t, transmitter_c::comboDirectOutput_t,
+                                           transmitter_c::comboDirectOutput_t );
+      unsigned long setMessageComboPWM( transmitter_c::channel_t, transmitter_c::pwmOutput_t, transmitter_c::pwmOutput_t );
+      unsigned long setMessageExtended( transmitter_c::channel_t, transmitter_c::extendedData_t );
+      unsigned long setMessageSingleOutputCstid( transmitter_c::channel_t, transmitter_c::singleOutput_t,
+                                                 transmitter_c::singleOutputCstid_t );
+      unsigned long setMessageSingleOutputPWM( transmitter_c::channel_t, transmitter_c::singleOutput_t,
+                                               transmitter_c::pwmOutput_t );
+
+    private:
+      static const unsigned long magic = 0x50465343; // "PFSC"
+
+      // Every word on its own cache line: writers of one channel don't slow down the others, and the transmitter
+      // storing applied doesn't invalidate the line the writers compare-and-swap state on
+      struct slot_t
+      {
+        alignas( 64 ) std::atomic< unsigned long long > state;
+        alignas( 64 ) std::atomic< unsigned long long > applied;
+      };
+
+      struct segment_t
+      {
+        std::atomic< unsigned long > magic;
+        slot_t                       slots[ transmitter_c::CHANNEL_NUM ];
+      };
+
+      bool          map( int );
+      unsigned long post( command_t::kind_t, transmitter_c::channel_t, unsigned int, unsigned int, unsigned int );
+
+      segment_t* _segment;
+    };
+
+    /*
+      Transmitter sending from its own worker thread.
+      The set-functions only put a command into the mailbox and never wait for sendMessages(), they return false
+      if the mailbox is full. Commands are passed to the transmitter between two rounds of sendMessages(), at most
+      one per channel and round, and not before the previous message of the channel was sent all its repeats; the
+      others stay queued, so no command is overwritten before it was on air. Only a waiting Combo command is
+      replaced by a newer Combo command of its channel, the transmitter would repeat just the newer one anyway.
+      With a shared control segment, changed slots are picked up between two rounds as well, by plain loads.
+    */
+    class hostTransmitter_c
+    {
+    public:
+      hostTransmitter_c( output_c&, sharedControl_c* = 0 );
+      ~hostTransmitter_c();
+
+      unsigned long rounds() const;
+      bool          setMessageComboDirect( transmitter_c::channel_t, transmitter_c::comboDirectOutput_t,
+                                           transmitter_c::comboDirectOutput_t );
+      bool          setMessageComboPWM( transmitter_c::channel_t, transmitter_c::pwmOutput_t, transmitter_c::pwmOutput_t );
+      bool          setMessageExtended( transmitter_c::channel_t, transmitter_c::extendedData_t );
+      bool          setMessageSingleOutputCstid( transmitter_c::channel_t, transmitter_c::singleOutput_t,
+                                                 transmitter_c::singleOutputCstid_t );
+      bool          setMessageSingleOutputPWM( transmitter_c::channel_t, transmitter_c::singleOutput_t,
+                                               transmitter_c::pwmOutput_t );
+      void          start();
+      void          stop();
+
+    private:
+      enum
+      {
+        PENDING_NUM = 64
+      };
+
+      static bool continuous( const command_t& );
+
+      void apply( const command_t& );
+      bool post( command_t::kind_t, transmitter_c::channel_t, unsigned int, unsigned int, unsigned int );
+      void queue( const command_t& );
+      void run();
+
+      sharedControl_c*             _control;
+      mailbox_c                    _mailbox;
+      std::deque< command_t >      _pending;
+      std::atomic< unsigned long > _rounds;
+      std::atomic< bool >          _running;
+      transmitter_c                _transmitter;
+      unsigned long                _versions[ transmitter_c::CHANNEL_NUM ];
+      std::thread                  _worker;
+    };
+  }
+}
+
+#endif
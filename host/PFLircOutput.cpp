@@ -0,0 +1,205 @@
+#include "PFLircOutput.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    /*
+      Constructor
+    */
+    lircOutput_c::lircOutput_c( int fd ) :
+      _errors( 0 ),
+      _fd( fd ),
+      _histogram( 1000, 0 ),
+      _messagePending( false ),
+      _messageStart( 0 ),
+      _maximumLateness( 0 ),
+      _pendingMark( 0 ),
+      _pendingSpace( 0 ),
+      _scheduleTime( 0 ),
+      _started( false ),
+      _writes( 0 )
+    {
+    }
+
+    /*
+      Get resolution of the lateness histogram (microseconds)
+    */
+    unsigned long lircOutput_c::bucketLength()
+    {
+      return 10;
+    }
+
+    /*
+      Get pause after which a message is complete (longer than any pause inside a message)
+    */
+    unsigned long lircOutput_c::idleTime()
+    {
+      return ( 39 + 6 ) * cycleLength();
+    }
+
+    /*
+      Add a line to the buffer
+    */
+    void lircOutput_c::addLine( const char* kind, unsigned long duration )
+    {
+      char line[ 32 ];
+
+      std::snprintf( line, sizeof( line ), "%s %lu\n", kind, duration );
+      _buffer += line;
+    }
+
+    /*
+      Get number of failed writes
+    */
+    unsigned long lircOutput_c::errors() const
+    {
+      return _errors;
+    }
+
+    /*
+      Wait until the pending message starts and write it
+    */
+    void lircOutput_c::flush()
+    {
+      const clock_t::time_point due = _start + std::chrono::microseconds( _messageStart );
+
+      std::this_thread::sleep_until( due );
+
+      for ( size_t written = 0; written < _buffer.size(); )
+      {
+        const ssize_t result = ::write( _fd, _buffer.data() + written, _buffer.size() - written );
+
+        if ( result <= 0 )
+        {
+          _errors++;
+          break;
+        }
+        written += result;
+      }
+
+      // Measured after the write, so a blocking pipe or device counts as late
+      const clock_t::time_point now = clock_t::now();
+      const unsigned long       late =
+        now > due ? std::chrono::duration_cast< std::chrono::microseconds >( now - due ).count() : 0;
+
+      _histogram[ std::min< unsigned long >( late / bucketLength(), _histogram.size() - 1 ) ]++;
+      _maximumLateness = std::max( _maximumLateness, late );
+      _writes++;
+
+      _buffer.clear();
+      _messagePending = false;
+    }
+
+    /*
+      Get lateness of the writes not exceeded by the given fraction (microseconds).
+      Interpolated inside the bucket, never more than the maximum.
+    */
+    double lircOutput_c::lateness( double fraction ) const
+    {
+      const unsigned long limit = static_cast< unsigned long >( fraction * _writes );
+      unsigned long       count = 0;
+
+      for ( size_t bucket = 0; bucket < _histogram.size(); bucket++ )
+      {
+        if ( count + _histogram[ bucket ] > limit )
+        {
+          const double position = ( limit - count + 1.0 ) / _histogram[ bucket ];
+
+          return std::min( ( bucket + position ) * bucketLength(), maximumLateness() );
+        }
+        count += _histogram[ bucket ];
+      }
+
+      return maximumLateness();
+    }
+
+    /*
+      Send carrier (cycles)
+    */
+    void lircOutput_c::mark( unsigned int cycles )
+    {
+      start();
+
+      if ( !_messagePending )
+      {
+        _messagePending = true;
+        _messageStart = _scheduleTime;
+      }
+
+      if ( _pendingSpace > 0 )
+      {
+        // mode2 starts with a pulse, the pause of idle channels before the first message is dropped
+        if ( _writes > 0 || !_buffer.empty() )
+        {
+          addLine( "space", _pendingSpace );
+        }
+        _pendingSpace = 0;
+      }
+
+      _pendingMark += cycles * cycleLength();
+      _scheduleTime += cycles * cycleLength();
+    }
+
+    /*
+      Get maximum lateness of a write (microseconds)
+    */
+    double lircOutput_c::maximumLateness() const
+    {
+      return _maximumLateness;
+    }
+
+    /*
+      Wait without carrier (microseconds)
+    */
+    void lircOutput_c::space( unsigned long waitTime )
+    {
+      start();
+
+      if ( _pendingMark > 0 )
+      {
+        addLine( "pulse", _pendingMark );
+        _pendingMark = 0;
+      }
+
+      _pendingSpace += waitTime;
+      _scheduleTime += waitTime;
+
+      if ( _messagePending && _pendingSpace >= idleTime() )
+      {
+        flush();
+      }
+
+      if ( !_messagePending )
+      {
+        // Nothing to write, wait until the schedule is reached
+        std::this_thread::sleep_until( _start + std::chrono::microseconds( _scheduleTime ) );
+      }
+    }
+
+    /*
+      Start schedule with the first mark or space
+    */
+    void lircOutput_c::start()
+    {
+      if ( !_started )
+      {
+        _start = clock_t::now();
+        _started = true;
+      }
+    }
+
+    /*
+      Get number of written messages
+    */
+    unsigned long lircOutput_c::writes() const
+    {
+      return _writes;
+    }
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef PF_LIRC_OUTPUT_H
+#define PF_LIRC_OUTPUT_H
+
+#include <PFOutput.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace PF_n
+{
+  namespace host_n
+  {
+    /*
+      Writes marks and spaces as LIRC mode2 text ("pulse 156", "space 1014") to a file descriptor.
+      A message is written at once when it is complete, at the time it starts according to the schedule.
+      Lateness against the schedule is recorded when a write completed, so blocking writes count.
+    */
+    class lircOutput_c : public output_c
+    {
+    public:
+      lircOutput_c( int );
+
+      unsigned long errors() const;
+      double        lateness( double ) const;
+      virtual void  mark( unsigned int );
+      double        maximumLateness() const;
+      virtual void  space( unsigned long );
+      unsigned long writes() const;
+
+    private:
+      typedef std::chrono::steady_clock clock_t;
+
+      static unsigned long bucketLength();
+      static unsigned long idleTime();
+
+      void addLine( const char*, unsigned long );
+      void flush();
+      void start();
+
+      std::string                  _buffer;
+      unsigned long                _errors;
+      int                          _fd;
+      std::vector< unsigned long > _histogram;
+      bool                         _messagePending;
+      unsigned long long           _messageStart;
+      unsigned long                _maximumLateness;
+      unsigned long                _pendingMark;
+      unsigned long                _pendingSpace;
+      unsigned long long           _scheduleTime;
+      clock_t::time_point          _start;
+      bool                         _started;
+      unsigned long                _writes;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+  Energy estimate of a battery powered transmitter, busy waiting (bitBangOutput_c) compared to sleeping
+  between edges (sleepOutput_c).
+
+  The schedule is recorded from the library. While busy waiting the CPU is always active; while sleeping it is
+  only active for every mark and space (start of the timer, interrupt), for encoding a message and for the
+  millis() interrupt. The IR-LED needs the same energy in both cases.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp host/PFHost.cpp host/energyEstimate.cpp -o energyEstimate
+*/
+
+#include "PFHost.h"
+
+#include <PFTransmitter.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+  // ATmega328P at 16 MHz and 5 V, IR-LED with 50 % duty cycle during marks
+  const double activeCurrent   = 9.0;  // mA
+  const double idleCurrent     = 3.0;  // mA
+  const double ledCurrent      = 50.0; // mA
+  const double batteryCapacity = 2000; // mAh
+
+  // Time the CPU is awake while sleeping between edges
+  const double wakeTimePerCall    = 10.0;   // us, start timer and handle interrupt
+  const double wakeTimePerMessage = 100.0;  // us, encoding
+  const double wakeTimePerTick    = 5.0;    // us, millis() interrupt
+  const double tickInterval       = 1024.0; // us
+
+  /*
+    Print one model
+  */
+  void printModel( const char* name, double activeTime, double totalTime, double ledTime )
+  {
+    const double current = ( activeCurrent * activeTime + idleCurrent * ( totalTime - activeTime ) + ledCurrent * ledTime ) /
+                           totalTime;
+
+    std::printf( "%-10s  active %6.2f %%  average %6.2f mA  battery life %6.1f h\n", name, 100.0 * activeTime / totalTime,
+                 current, batteryCapacity / current );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  const unsigned long rounds = argc > 1 ? std::strtoul( argv[ 1 ], 0, 10 ) : 1000;
+
+  PF_n::host_n::scheduleOutput_c output;
+  PF_n::transmitter_c            transmitter( output );
+  unsigned long                  messages = 0;
+
+  // Like the example: joystick on channel 1, buttons on channel 2
+  transmitter.setMessageComboPWM( PF_n::transmitter_c::CHANNEL_1, PF_n::transmitter_c::PWM_OUTPUT_FORWARD_4, false,
+                                  PF_n::transmitter_c::PWM_OUTPUT_BRAKE_FLOAT, false );
+  transmitter.setMessageComboDirect( PF_n::transmitter_c::CHANNEL_2, PF_n::transmitter_c::COMBO_DIRECT_OUTPUT_FLOAT, false,
+                                     PF_n::transmitter_c::COMBO_DIRECT_OUTPUT_FORWARD, false );
+
+  for ( unsigned long round = 0; round < rounds; round++ )
+  {
+    transmitter.sendMessages();
+    messages += PF_n::transmitter_c::CHANNEL_NUM;
+  }
+
+  double totalTime = 0;
+  double markTime = 0;
+
+  for ( std::vector< PF_n::host_n::pulse_t >::const_iterator pulse = output.pulses().begin();
+        pulse != output.pulses().end(); ++pulse )
+  {
+    totalTime += pulse->duration;
+    if ( pulse->mark )
+    {
+      markTime += pulse->duration;
+    }
+  }
+
+  const double sleepActiveTime = output.calls() * wakeTimePerCall + messages * wakeTimePerMessage +
+                                 totalTime / tickInterval * wakeTimePerTick;
+
+  std::printf( "schedule    %.1f s, %lu messages, %lu marks and spaces, carrier %.2f %%\n", totalTime / 1e6, messages,
+               output.calls(), 100.0 * markTime / totalTime );
+
+  printModel( "busy wait", totalTime, totalTime, markTime / 2 );
+  printModel( "sleep", sleepActiveTime < totalTime ? sleepActiveTime : totalTime, totalTime, markTime / 2 );
+
+  return 0;
+}
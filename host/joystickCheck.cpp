@@ -0,0 +1,168 @@
+/*
+  Check of joystick_c: the analog inputs of a simulated controller are set with setAnalogValue(), the Combo-PWM
+  messages the joystick passes to the transmitter are decoded from the recorded schedule.
+  - Before calibrate() both outputs are brake, whatever the position of the axes.
+  - Values inside the deadband are brake, the steps begin at the thresholds and reach 7 at full deflection.
+  - A step only changes if the axis moved more than the hysteresis beyond the threshold.
+  - Inverting an axis swaps forward and backward.
+  - update() only passes a message if an output changed.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp PFInput.cpp host/PFHost.cpp host/joystickCheck.cpp -o joystickCheck
+*/
+
+#include "PFHost.h"
+
+#include <PFInput.h>
+#include <PFTransmitter.h>
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+  typedef PF_n::transmitter_c transmitter_t;
+
+  const int pinX = 0;
+  const int pinY = 1;
+
+  // Calibration: full forward 1023, centre 512 (default of the analog inputs), full backward 0
+  const int          centre     = 512;
+  const unsigned int deadband   = 50;
+  const unsigned int hysteresis = 20;
+
+  // Distances from the centre where the steps 1 and 2 begin: deadband + ( 511 - deadband ) * step / 7
+  const int step1 = 50;
+  const int step2 = 115;
+
+  /*
+    Outputs of the last message the transmitter sent
+  */
+  struct outputs_t
+  {
+    bool                       sent;
+    transmitter_t::pwmOutput_t outputA;
+    transmitter_t::pwmOutput_t outputB;
+  };
+
+  /*
+    Send a round and decode the Combo-PWM message of channel 1
+  */
+  outputs_t send( transmitter_t& transmitter, PF_n::host_n::scheduleOutput_c& schedule )
+  {
+    std::vector< PF_n::host_n::mark_t > marks;
+    unsigned long long                  time = 0;
+    outputs_t                           outputs = { false, transmitter_t::PWM_OUTPUT_FLOAT, transmitter_t::PWM_OUTPUT_FLOAT };
+
+    schedule.clear();
+    transmitter.sendMessages();
+
+    for ( std::vector< PF_n::host_n::pulse_t >::const_iterator pulse = schedule.pulses().begin();
+          pulse != schedule.pulses().end(); ++pulse )
+    {
+      if ( pulse->mark )
+      {
+        PF_n::host_n::mark_t mark = { time, time + pulse->duration * 1000ULL };
+        marks.push_back( mark );
+      }
+      time += pulse->duration * 1000ULL;
+    }
+
+    const std::vector< PF_n::host_n::frame_t > frames = PF_n::host_n::receiver_c::decode( marks );
+
+    if ( !frames.empty() && ( frames.back().nibbles[ 0 ] & 0x4 ) != 0 )
+    {
+      outputs.sent = true;
+      outputs.outputA = transmitter_t::pwmOutput_t( frames.back().nibbles[ 2 ] );
+      outputs.outputB = transmitter_t::pwmOutput_t( frames.back().nibbles[ 1 ] );
+    }
+
+    return outputs;
+  }
+
+  /*
+    Count a failed check
+  */
+  void check( bool condition, unsigned long& failures, const char* what )
+  {
+    if ( !condition )
+    {
+      std::printf( "FAIL: %s\n", what );
+      failures++;
+    }
+  }
+
+  /*
+    Move the joystick, update and check the outputs of the sent message
+  */
+  void expect( PF_n::host_n::mcu_c& mcu, PF_n::joystick_c& joystick, transmitter_t& transmitter,
+               PF_n::host_n::scheduleOutput_c& schedule, int x, int y, bool inverseX, transmitter_t::pwmOutput_t outputA,
+               transmitter_t::pwmOutput_t outputB, unsigned long& failures, const char* what )
+  {
+    mcu.setAnalogValue( pinX, x );
+    mcu.setAnalogValue( pinY, y );
+    joystick.update( inverseX, false );
+
+    const outputs_t outputs = send( transmitter, schedule );
+
+    check( outputs.sent && outputs.outputA == outputA && outputs.outputB == outputB, failures, what );
+  }
+}
+
+int main()
+{
+  PF_n::host_n::room_c           room;
+  PF_n::host_n::mcu_c            mcu( room, 1 );
+  PF_n::host_n::scheduleOutput_c schedule;
+  unsigned long                  failures = 0;
+
+  mcu.activate();
+
+  transmitter_t    transmitter( schedule );
+  PF_n::joystick_c joystick( transmitter, transmitter_t::CHANNEL_1, pinX, pinY );
+
+  // Uncalibrated
+  expect( mcu, joystick, transmitter, schedule, 1023, 0, false, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT,
+          transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures, "uncalibrated axes are not brake" );
+
+  mcu.setAnalogValue( pinX, centre );
+  mcu.setAnalogValue( pinY, centre );
+  joystick.calibrate( 1023, 0, 1023, 0, deadband, hysteresis );
+
+  // Deadband and full deflection
+  expect( mcu, joystick, transmitter, schedule, centre + step1 - 1, centre - step1 + 1, false,
+          transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures,
+          "value inside the deadband is not brake" );
+  expect( mcu, joystick, transmitter, schedule, centre + step1 + hysteresis, centre - step1 - hysteresis, false,
+          transmitter_t::PWM_OUTPUT_FORWARD_1, transmitter_t::PWM_OUTPUT_BACKWARD_1, failures,
+          "step 1 doesn't begin at the deadband plus hysteresis" );
+  expect( mcu, joystick, transmitter, schedule, 1023, 0, false, transmitter_t::PWM_OUTPUT_FORWARD_7,
+          transmitter_t::PWM_OUTPUT_BACKWARD_7, failures, "full deflection is not step 7" );
+
+  // Hysteresis, up from step 1 and down from step 2
+  expect( mcu, joystick, transmitter, schedule, centre + step1 + 10, centre, false, transmitter_t::PWM_OUTPUT_FORWARD_1,
+          transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures, "step 1" );
+  expect( mcu, joystick, transmitter, schedule, centre + step2 + hysteresis - 1, centre, false,
+          transmitter_t::PWM_OUTPUT_FORWARD_1, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures,
+          "step changed inside the hysteresis (up)" );
+  expect( mcu, joystick, transmitter, schedule, centre + step2 + hysteresis, centre, false, transmitter_t::PWM_OUTPUT_FORWARD_2,
+          transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures, "step didn't change beyond the hysteresis (up)" );
+  expect( mcu, joystick, transmitter, schedule, centre + step2 - hysteresis, centre, false, transmitter_t::PWM_OUTPUT_FORWARD_2,
+          transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures, "step changed inside the hysteresis (down)" );
+  expect( mcu, joystick, transmitter, schedule, centre + step2 - hysteresis - 1, centre, false,
+          transmitter_t::PWM_OUTPUT_FORWARD_1, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT, failures,
+          "step didn't change beyond the hysteresis (down)" );
+
+  // Inversion
+  expect( mcu, joystick, transmitter, schedule, 1023, 1023, true, transmitter_t::PWM_OUTPUT_BACKWARD_7,
+          transmitter_t::PWM_OUTPUT_FORWARD_7, failures, "inverted axis doesn't swap the direction" );
+
+  // No message if nothing changed
+  check( !joystick.update( true, false ), failures, "message passed although the outputs didn't change" );
+  mcu.setAnalogValue( pinY, centre );
+  check( joystick.update( true, false ), failures, "no message although an output changed" );
+
+  std::printf( "%s\n", failures == 0 ? "PASS" : "FAIL" );
+
+  return failures == 0 ? 0 : 1;
+}
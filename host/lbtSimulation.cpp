@@ -0,0 +1,150 @@
+/*
+  Simulation of several transmitters in one room, with and without listen-before-talk.
+
+  Every transmitter runs the library in its own simulated controller and sends a Combo-PWM message on its own
+  channel. A receiver which sees all IR-LEDs decodes the room; a message is delivered if it is decoded unchanged.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp host/PFHost.cpp host/lbtSimulation.cpp -o lbtSimulation
+*/
+
+#include "PFHost.h"
+
+#include <PFTransmitter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+  const int pinIrLed      = 8;
+  const int pinIrReceiver = 7;
+
+  struct result_t
+  {
+    unsigned long sent;
+    unsigned long delivered;
+    unsigned long deferrals;
+    unsigned long collisions;
+  };
+
+  /*
+    Program of one controller
+  */
+  void runController( PF_n::host_n::mcu_c& mcu, PF_n::transmitter_c::channel_t channel, bool listenBeforeTalk,
+                      unsigned long duration, result_t& result )
+  {
+    mcu.activate();
+    mcu.setLedPin( pinIrLed );
+    mcu.setReceiverPin( pinIrReceiver );
+
+    PF_n::transmitter_c transmitter( pinIrLed, listenBeforeTalk ? pinIrReceiver : -1 );
+
+    transmitter.setMessageComboPWM( channel, PF_n::transmitter_c::PWM_OUTPUT_FORWARD_3, false,
+                                    PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_5, false );
+
+    while ( mcu.micros() < duration )
+    {
+      transmitter.sendMessages();
+    }
+
+    result.deferrals = transmitter.deferrals();
+    result.collisions = transmitter.collisions();
+
+    mcu.finish();
+  }
+
+  /*
+    Run one room and return the sum over all transmitters
+  */
+  result_t simulate( int transmitters, bool listenBeforeTalk, unsigned long duration, unsigned long seed )
+  {
+    std::mt19937                           random( seed );
+    std::uniform_real_distribution<>       drift( -0.005, 0.005 );
+    std::uniform_int_distribution< long >  offset( 0, 5 * 16000000L );
+    PF_n::host_n::room_c                   room;
+    std::vector< PF_n::host_n::mcu_c* >    mcus;
+    std::vector< result_t >                results( transmitters );
+    std::vector< std::thread >             threads;
+
+    for ( int transmitter = 0; transmitter < transmitters; transmitter++ )
+    {
+      mcus.push_back( new PF_n::host_n::mcu_c( room, random(), drift( random ), offset( random ) ) );
+    }
+
+    for ( int transmitter = 0; transmitter < transmitters; transmitter++ )
+    {
+      threads.push_back( std::thread( runController, std::ref( *mcus[ transmitter ] ),
+                                      PF_n::transmitter_c::channel_t( transmitter % PF_n::transmitter_c::CHANNEL_NUM ),
+                                      listenBeforeTalk, duration, std::ref( results[ transmitter ] ) ) );
+    }
+
+    for ( size_t thread = 0; thread < threads.size(); thread++ )
+    {
+      threads[ thread ].join();
+    }
+
+    std::vector< std::vector< PF_n::host_n::mark_t > > marks;
+
+    for ( int transmitter = 0; transmitter < transmitters; transmitter++ )
+    {
+      marks.push_back( mcus[ transmitter ]->marks() );
+    }
+
+    const std::vector< PF_n::host_n::frame_t > received =
+      PF_n::host_n::receiver_c::decode( PF_n::host_n::receiver_c::merge( marks ) );
+
+    result_t total = { 0, 0, 0, 0 };
+
+    for ( int transmitter = 0; transmitter < transmitters; transmitter++ )
+    {
+      const std::vector< PF_n::host_n::frame_t > sent = PF_n::host_n::receiver_c::decode( marks[ transmitter ] );
+
+      for ( size_t frame = 0; frame < sent.size(); frame++ )
+      {
+        std::vector< PF_n::host_n::frame_t >::const_iterator candidate =
+          std::lower_bound( received.begin(), received.end(), sent[ frame ],
+                            []( const PF_n::host_n::frame_t& left, const PF_n::host_n::frame_t& right )
+                            { return left.time < right.time; } );
+
+        if ( candidate != received.end() && candidate->time == sent[ frame ].time &&
+             std::equal( sent[ frame ].nibbles, sent[ frame ].nibbles + 4, candidate->nibbles ) )
+        {
+          total.delivered++;
+        }
+      }
+
+      total.sent += sent.size();
+      total.deferrals += results[ transmitter ].deferrals;
+      total.collisions += results[ transmitter ].collisions;
+
+      delete mcus[ transmitter ];
+    }
+
+    return total;
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  const unsigned long duration = argc > 1 ? std::strtoul( argv[ 1 ], 0, 10 ) * 1000000UL : 20000000UL;
+  const unsigned long seed     = argc > 2 ? std::strtoul( argv[ 2 ], 0, 10 ) : 1;
+
+  std::printf( "transmitters  lbt  sent  delivered  rate    deferrals  collisions\n" );
+
+  for ( int transmitters = 1; transmitters <= PF_n::transmitter_c::CHANNEL_NUM; transmitters++ )
+  {
+    for ( int listenBeforeTalk = 0; listenBeforeTalk <= 1; listenBeforeTalk++ )
+    {
+      const result_t result = simulate( transmitters, listenBeforeTalk != 0, duration, seed );
+
+      std::printf( "%12d  %3s  %4lu  %9lu  %5.1f%%  %9lu  %10lu\n", transmitters, listenBeforeTalk ? "on" : "off",
+                   result.sent, result.delivered, result.sent > 0 ? 100.0 * result.delivered / result.sent : 0.0,
+                   result.deferrals, result.collisions );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+  Sends LIRC mode2 text to a file, pipe or device while control threads change the messages.
+  Reports how close the writes follow the schedule, optionally with additional CPU load.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp host/PFHost.cpp host/PFLircOutput.cpp host/PFHostTransmitter.cpp host/lircTransmitter.cpp -o lircTransmitter -lrt
+
+  Usage:
+    ./lircTransmitter <file|-> [seconds] [control threads] [load threads]
+    mkfifo /tmp/pf && cat /tmp/pf > /dev/null & ./lircTransmitter /tmp/pf 10 4 8
+*/
+
+#include "PFHostTransmitter.h"
+#include "PFLircOutput.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+  std::atomic< bool >          running( true );
+  std::atomic< unsigned long > commands( 0 );
+  std::atomic< unsigned long > rejected( 0 );
+
+  /*
+    Control thread: changes the message of its channel about every 20 ms
+  */
+  void control( PF_n::host_n::hostTransmitter_c& transmitter, int index )
+  {
+    std::mt19937                         random( index );
+    std::uniform_int_distribution< int > pwm( 0, 15 );
+    const PF_n::transmitter_c::channel_t channel =
+      PF_n::transmitter_c::channel_t( index % PF_n::transmitter_c::CHANNEL_NUM );
+
+    while ( running.load() )
+    {
+      if ( transmitter.setMessageComboPWM( channel, PF_n::transmitter_c::pwmOutput_t( pwm( random ) ),
+                                           PF_n::transmitter_c::pwmOutput_t( pwm( random ) ) ) )
+      {
+        commands++;
+      }
+      else
+      {
+        rejected++;
+      }
+      std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    }
+  }
+
+  /*
+    Load thread: keeps a CPU busy
+  */
+  void load()
+  {
+    volatile unsigned long counter = 0;
+
+    while ( running.load( std::memory_order_relaxed ) )
+    {
+      counter++;
+    }
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 2 )
+  {
+    std::fprintf( stderr, "usage: %s <file|-> [seconds] [control threads] [load threads]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  const int seconds        = argc > 2 ? std::atoi( argv[ 2 ] ) : 10;
+  const int controlThreads = argc > 3 ? std::atoi( argv[ 3 ] ) : 2;
+  const int loadThreads    = argc > 4 ? std::atoi( argv[ 4 ] ) : 0;
+  const int fd             = std::strcmp( argv[ 1 ], "-" ) == 0 ? STDOUT_FILENO :
+                                                                  ::open( argv[ 1 ], O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+  if ( fd < 0 )
+  {
+    std::perror( argv[ 1 ] );
+    return 1;
+  }
+
+  PF_n::host_n::lircOutput_c      output( fd );
+  PF_n::host_n::hostTransmitter_c transmitter( output );
+  std::vector< std::thread >      threads;
+
+  transmitter.start();
+
+  for ( int thread = 0; thread < controlThreads; thread++ )
+  {
+    threads.push_back( std::thread( control, std::ref( transmitter ), thread ) );
+  }
+  for ( int thread = 0; thread < loadThreads; thread++ )
+  {
+    threads.push_back( std::thread( load ) );
+  }
+
+  std::this_thread::sleep_for( std::chrono::seconds( seconds ) );
+
+  running.store( false );
+  for ( size_t thread = 0; thread < threads.size(); thread++ )
+  {
+    threads[ thread ].join();
+  }
+  transmitter.stop();
+
+  if ( fd != STDOUT_FILENO )
+  {
+    ::close( fd );
+  }
+
+  std::fprintf( stderr, "rounds %lu, messages written %lu, write errors %lu, commands %lu, rejected %lu\n",
+                transmitter.rounds(), output.writes(), output.errors(), commands.load(), rejected.load() );
+  std::fprintf( stderr, "lateness of writes: median %.0f us, 99 %% %.0f us, maximum %.0f us\n", output.lateness( 0.5 ),
+                output.lateness( 0.99 ), output.maximumLateness() );
+
+  return 0;
+}
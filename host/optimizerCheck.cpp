@@ -0,0 +1,399 @@
+/*
+  Check of the messages chosen by optimizer_c against the frames which are really sent.
+
+  A sequence of output pairs is set on all channels, every step runs holdRounds rounds of update() and
+  sendMessages() into a recorded schedule. The schedule is decoded again and
+  - every message which isn't repeated forever must be sent exactly 5 times,
+  - a receiver which follows the decoded frames must reach the desired outputs at the end of every step, outputs
+    set by Combo or full forward/backward messages time out after 15 rounds (1.2 s) without a frame,
+  - the airtime of the decoded frames must equal airtime() of the optimizer,
+  - the same sequence sent as Combo-PWM messages only must take savedAirtime() more.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp PFOptimizer.cpp host/PFHost.cpp host/optimizerCheck.cpp -o optimizerCheck
+*/
+
+#include "PFHost.h"
+
+#include <PFOptimizer.h>
+#include <PFTransmitter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+  typedef PF_n::transmitter_c transmitter_t;
+
+  /*
+    Desired outputs of one step
+  */
+  struct step_t
+  {
+    transmitter_t::pwmOutput_t outputA;
+    transmitter_t::pwmOutput_t outputB;
+  };
+
+  /*
+    Outputs of a receiver, the last frame of its channel detects repeats
+  */
+  struct receiverState_t
+  {
+    bool                       known;
+    unsigned int               last[ 4 ];
+    size_t                     lastRound;
+    transmitter_t::pwmOutput_t outputA;
+    transmitter_t::pwmOutput_t outputB;
+    bool                       timeoutA;
+    bool                       timeoutB;
+  };
+
+  // Starts with a full backward output ahead of another output, passes Combo-Direct on the way
+  const step_t steps[] =
+  {
+    { transmitter_t::PWM_OUTPUT_BACKWARD_7, transmitter_t::PWM_OUTPUT_FORWARD_3 },
+    { transmitter_t::PWM_OUTPUT_FORWARD_3, transmitter_t::PWM_OUTPUT_FLOAT },
+    { transmitter_t::PWM_OUTPUT_FORWARD_4, transmitter_t::PWM_OUTPUT_FLOAT },
+    { transmitter_t::PWM_OUTPUT_FORWARD_5, transmitter_t::PWM_OUTPUT_FORWARD_2 },
+    { transmitter_t::PWM_OUTPUT_FORWARD_7, transmitter_t::PWM_OUTPUT_BACKWARD_7 },
+    { transmitter_t::PWM_OUTPUT_FORWARD_7, transmitter_t::PWM_OUTPUT_FORWARD_3 },
+    { transmitter_t::PWM_OUTPUT_FORWARD_6, transmitter_t::PWM_OUTPUT_FORWARD_1 },
+    { transmitter_t::PWM_OUTPUT_BACKWARD_7, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT },
+    { transmitter_t::PWM_OUTPUT_BACKWARD_6, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT },
+    { transmitter_t::PWM_OUTPUT_FLOAT, transmitter_t::PWM_OUTPUT_FORWARD_7 },
+    { transmitter_t::PWM_OUTPUT_BACKWARD_1, transmitter_t::PWM_OUTPUT_FORWARD_7 },
+    { transmitter_t::PWM_OUTPUT_FLOAT, transmitter_t::PWM_OUTPUT_FLOAT }
+  };
+  const unsigned int stepNum = sizeof( steps ) / sizeof( steps[ 0 ] );
+
+  // Messages which aren't repeated forever are sent 5 times (channel_c::maximumRepeats())
+  const unsigned long maximumRepeats = 5;
+
+  // Rounds without a frame after which the receiver times out (1.2 s)
+  const size_t timeoutRounds = 15;
+
+  /*
+    Desired outputs of a channel in a step, every channel runs through the sequence with another offset
+  */
+  const step_t& stepOf( unsigned int step, int channel )
+  {
+    return steps[ ( step + 3 * channel ) % stepNum ];
+  }
+
+  /*
+    Split a recorded schedule into marks
+  */
+  std::vector< PF_n::host_n::mark_t > marksOf( const PF_n::host_n::scheduleOutput_c& schedule )
+  {
+    std::vector< PF_n::host_n::mark_t > marks;
+    unsigned long long                  time = 0;
+
+    for ( std::vector< PF_n::host_n::pulse_t >::const_iterator pulse = schedule.pulses().begin();
+          pulse != schedule.pulses().end(); ++pulse )
+    {
+      if ( pulse->mark )
+      {
+        PF_n::host_n::mark_t mark = { time, time + pulse->duration * 1000ULL };
+        marks.push_back( mark );
+      }
+      time += pulse->duration * 1000ULL;
+    }
+
+    return marks;
+  }
+
+  /*
+    Airtime of a frame (us): start and stop bit and 16 data bits
+  */
+  unsigned long airtimeOf( const PF_n::host_n::frame_t& frame )
+  {
+    unsigned long cycles = 2 * ( 6 + 39 );
+
+    for ( int nibble = 0; nibble < 4; nibble++ )
+    {
+      for ( int bit = 3; bit >= 0; bit-- )
+      {
+        cycles += ( frame.nibbles[ nibble ] & ( 1 << bit ) ) != 0 ? 6 + 21 : 6 + 10;
+      }
+    }
+
+    return cycles * PF_n::output_c::cycleLength();
+  }
+
+  /*
+    Check if a frame is a Single-Output message
+  */
+  bool singleOutput( const PF_n::host_n::frame_t& frame )
+  {
+    return ( frame.nibbles[ 0 ] & 0x4 ) == 0 && ( frame.nibbles[ 1 ] & 0x4 ) != 0;
+  }
+
+  /*
+    Check if the transmitter repeats the message of a frame forever
+  */
+  bool repeatedForever( const PF_n::host_n::frame_t& frame )
+  {
+    return !singleOutput( frame ) ||
+           ( ( frame.nibbles[ 1 ] & 0x2 ) != 0 && ( frame.nibbles[ 2 ] == transmitter_t::SINGLE_OUTPUT_CSTID_FULL_FORWARD ||
+                                                   frame.nibbles[ 2 ] == transmitter_t::SINGLE_OUTPUT_CSTID_FULL_BACKWARD ) );
+  }
+
+  /*
+    Step of a PWM-output (negative: backward)
+  */
+  int stepOfOutput( transmitter_t::pwmOutput_t output )
+  {
+    return output < transmitter_t::PWM_OUTPUT_BRAKE_FLOAT ? int( output ) : int( output ) - 16;
+  }
+
+  /*
+    PWM-output of a Combo-Direct output
+  */
+  transmitter_t::pwmOutput_t comboDirectPwm( unsigned int output )
+  {
+    const transmitter_t::pwmOutput_t outputs[] = { transmitter_t::PWM_OUTPUT_FLOAT, transmitter_t::PWM_OUTPUT_FORWARD_7,
+                                                   transmitter_t::PWM_OUTPUT_BACKWARD_7, transmitter_t::PWM_OUTPUT_BRAKE_FLOAT };
+
+    return outputs[ output & 0x3 ];
+  }
+
+  /*
+    Follow a frame like a receiver: Single-Output messages only count once per toggle-bit
+  */
+  void receive( receiverState_t& state, const PF_n::host_n::frame_t& frame, size_t round )
+  {
+    const bool repeat = state.known && std::equal( frame.nibbles, frame.nibbles + 4, state.last );
+
+    std::copy( frame.nibbles, frame.nibbles + 4, state.last );
+    state.known = true;
+    state.lastRound = round;
+
+    if ( ( frame.nibbles[ 0 ] & 0x4 ) != 0 )
+    {
+      state.outputA = transmitter_t::pwmOutput_t( frame.nibbles[ 2 ] );
+      state.outputB = transmitter_t::pwmOutput_t( frame.nibbles[ 1 ] );
+      state.timeoutA = true;
+      state.timeoutB = true;
+    }
+    else if ( frame.nibbles[ 1 ] == 1 )
+    {
+      state.outputA = comboDirectPwm( frame.nibbles[ 2 ] );
+      state.outputB = comboDirectPwm( frame.nibbles[ 2 ] >> 2 );
+      state.timeoutA = true;
+      state.timeoutB = true;
+    }
+    else if ( singleOutput( frame ) && !repeat )
+    {
+      transmitter_t::pwmOutput_t& output = ( frame.nibbles[ 1 ] & 0x1 ) == 0 ? state.outputA : state.outputB;
+      bool&                       timeout = ( frame.nibbles[ 1 ] & 0x1 ) == 0 ? state.timeoutA : state.timeoutB;
+
+      timeout = repeatedForever( frame );
+      if ( ( frame.nibbles[ 1 ] & 0x2 ) == 0 )
+      {
+        output = transmitter_t::pwmOutput_t( frame.nibbles[ 2 ] );
+      }
+      else
+      {
+        switch ( frame.nibbles[ 2 ] )
+        {
+        case transmitter_t::SINGLE_OUTPUT_CSTID_INCREMENT_PWM:
+          output = transmitter_t::pwmOutput_t( ( stepOfOutput( output ) + 1 + 16 ) % 16 );
+          break;
+
+        case transmitter_t::SINGLE_OUTPUT_CSTID_DECREMENT_PWM:
+          output = transmitter_t::pwmOutput_t( ( stepOfOutput( output ) - 1 + 16 ) % 16 );
+          break;
+
+        case transmitter_t::SINGLE_OUTPUT_CSTID_FULL_FORWARD:
+          output = transmitter_t::PWM_OUTPUT_FORWARD_7;
+          break;
+
+        case transmitter_t::SINGLE_OUTPUT_CSTID_FULL_BACKWARD:
+          output = transmitter_t::PWM_OUTPUT_BACKWARD_7;
+          break;
+        }
+      }
+    }
+  }
+
+  /*
+    Let the outputs of a receiver time out if no frame came for too long
+  */
+  void timeOut( receiverState_t& state, size_t round )
+  {
+    if ( state.known && round - state.lastRound > timeoutRounds )
+    {
+      state.outputA = state.timeoutA ? transmitter_t::PWM_OUTPUT_FLOAT : state.outputA;
+      state.outputB = state.timeoutB ? transmitter_t::PWM_OUTPUT_FLOAT : state.outputB;
+    }
+  }
+
+  /*
+    Length of a recorded schedule
+  */
+  unsigned long long timeOf( const PF_n::host_n::scheduleOutput_c& schedule )
+  {
+    unsigned long long time = 0;
+
+    for ( std::vector< PF_n::host_n::pulse_t >::const_iterator pulse = schedule.pulses().begin();
+          pulse != schedule.pulses().end(); ++pulse )
+    {
+      time += pulse->duration * 1000ULL;
+    }
+
+    return time;
+  }
+
+  /*
+    Count a failed check
+  */
+  void check( bool condition, unsigned long& failures, const char* what, unsigned long holdRounds, unsigned long where )
+  {
+    if ( !condition )
+    {
+      if ( failures < 10 )
+      {
+        std::printf( "FAIL: %s (hold rounds %lu, at %lu)\n", what, holdRounds, where );
+      }
+      failures++;
+    }
+  }
+
+  /*
+    Run the sequence with the optimizer and as Combo-PWM only
+  */
+  void checkSequence( unsigned int holdRounds, unsigned long& failures )
+  {
+    PF_n::host_n::scheduleOutput_c    optimized;
+    transmitter_t                     transmitter( optimized );
+    PF_n::optimizer_c                 optimizer( transmitter, holdRounds );
+    PF_n::host_n::scheduleOutput_c    plain;
+    transmitter_t                     plainTransmitter( plain );
+    std::vector< unsigned long long > roundEnds;
+    std::vector< size_t >             stepFrames;
+
+    for ( unsigned int step = 0; step < stepNum; step++ )
+    {
+      for ( int channel = transmitter_t::CHANNEL_1; channel < transmitter_t::CHANNEL_NUM; channel++ )
+      {
+        optimizer.setOutputs( transmitter_t::channel_t( channel ), stepOf( step, channel ).outputA,
+                              stepOf( step, channel ).outputB );
+        plainTransmitter.setMessageComboPWM( transmitter_t::channel_t( channel ), stepOf( step, channel ).outputA, false,
+                                             stepOf( step, channel ).outputB, false );
+      }
+
+      for ( unsigned int round = 0; round < holdRounds; round++ )
+      {
+        optimizer.update();
+        transmitter.sendMessages();
+        plainTransmitter.sendMessages();
+        roundEnds.push_back( timeOf( optimized ) );
+      }
+
+      stepFrames.push_back( PF_n::host_n::receiver_c::decode( marksOf( optimized ) ).size() );
+    }
+
+    const std::vector< PF_n::host_n::frame_t > frames = PF_n::host_n::receiver_c::decode( marksOf( optimized ) );
+    const std::vector< PF_n::host_n::frame_t > plainFrames = PF_n::host_n::receiver_c::decode( marksOf( plain ) );
+
+    // Receivers must reach the desired outputs at the end of every step
+    receiverState_t receivers[ transmitter_t::CHANNEL_NUM ] = {};
+    size_t          frame = 0;
+    size_t          round = 0;
+
+    for ( unsigned int step = 0; step < stepNum; step++ )
+    {
+      for ( ; frame < stepFrames[ step ]; frame++ )
+      {
+        while ( frames[ frame ].time >= roundEnds[ round ] )
+        {
+          round++;
+        }
+        receive( receivers[ frames[ frame ].nibbles[ 0 ] & 0x3 ], frames[ frame ], round );
+      }
+
+      for ( int channel = transmitter_t::CHANNEL_1; channel < transmitter_t::CHANNEL_NUM; channel++ )
+      {
+        timeOut( receivers[ channel ], ( step + 1 ) * holdRounds - 1 );
+        check( receivers[ channel ].outputA == stepOf( step, channel ).outputA &&
+                 receivers[ channel ].outputB == stepOf( step, channel ).outputB,
+               failures, "receiver didn't reach the desired outputs", holdRounds, step );
+      }
+    }
+
+    // Messages which aren't repeated forever are sent maximumRepeats times
+    unsigned long finiteMessages = 0;
+
+    for ( int channel = transmitter_t::CHANNEL_1; channel < transmitter_t::CHANNEL_NUM; channel++ )
+    {
+      std::vector< PF_n::host_n::frame_t > channelFrames;
+
+      for ( std::vector< PF_n::host_n::frame_t >::const_iterator channelFrame = frames.begin(); channelFrame != frames.end();
+            ++channelFrame )
+      {
+        if ( int( channelFrame->nibbles[ 0 ] & 0x3 ) == channel )
+        {
+          channelFrames.push_back( *channelFrame );
+        }
+      }
+
+      for ( size_t first = 0; first < channelFrames.size(); )
+      {
+        size_t last = first + 1;
+
+        while ( last < channelFrames.size() &&
+                std::equal( channelFrames[ last ].nibbles, channelFrames[ last ].nibbles + 4, channelFrames[ first ].nibbles ) )
+        {
+          last++;
+        }
+
+        if ( !repeatedForever( channelFrames[ first ] ) )
+        {
+          check( last - first == maximumRepeats, failures,
+                 "message not sent maximumRepeats times", holdRounds, first );
+          finiteMessages++;
+        }
+        first = last;
+      }
+    }
+
+    // Airtime of the decoded frames
+    unsigned long airtime = 0;
+    unsigned long plainAirtime = 0;
+
+    for ( size_t index = 0; index < frames.size(); index++ )
+    {
+      airtime += airtimeOf( frames[ index ] );
+    }
+    for ( size_t index = 0; index < plainFrames.size(); index++ )
+    {
+      plainAirtime += airtimeOf( plainFrames[ index ] );
+    }
+
+    check( airtime == optimizer.airtime(), failures, "airtime differs from the estimate", holdRounds, 0 );
+    check( long( plainAirtime ) - long( airtime ) == optimizer.savedAirtime(), failures, "saved airtime differs from the estimate",
+           holdRounds, 0 );
+
+    std::printf( "hold rounds %2u: %4lu frames (%lu finite messages), Combo-PWM only %4lu frames, "
+                 "airtime %lu us (estimate %lu us), saved %ld us (estimate %ld us)\n",
+                 holdRounds, static_cast< unsigned long >( frames.size() ), finiteMessages,
+                 static_cast< unsigned long >( plainFrames.size() ), airtime, optimizer.airtime(), long( plainAirtime ) - long( airtime ),
+                 optimizer.savedAirtime() );
+  }
+}
+
+int main()
+{
+  unsigned long failures = 0;
+
+  // 8 rounds make Combo messages cheaper if both outputs change, 12 rounds leave idle rounds between the messages
+  // which don't divide by maximumRepeats()
+  checkSequence( 8, failures );
+  checkSequence( 12, failures );
+  checkSequence( 25, failures );
+
+  std::printf( "%s\n", failures == 0 ? "PASS" : "FAIL" );
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+/*
+  Monte-Carlo simulation of a channel plan: many transmitters and receivers in one room.
+
+  Every trial is a room of transmitters with random clock drift and start offset, each runs the library in its own
+  simulated controller and changes its Combo-PWM message at random times. Transmitter i uses channel i modulo 4.
+  Every receiver obeys one transmitter and sees it and each other transmitter with the given probability; it decodes
+  the merged marks of all transmitters it sees, so overlapping messages are lost. The IR-receiver of a controller
+  (listen before talk) sees its own IR-LED and each other transmitter with the same probability.
+  A command is delivered if one of its frames reaches the receiver unchanged before the next command, its latency is
+  the time from setting the message to the end of that frame. Frames of other transmitters on the same channel which
+  reach a receiver are counted as conflicts.
+
+  Trials run in parallel on a pool of worker threads. A trial runs all its controllers in its worker (room_c::run()),
+  so trials share nothing and don't wait for each other; each trial has its own seed, so the results don't depend on
+  the number of workers.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp host/PFHost.cpp host/roomMonteCarlo.cpp -o roomMonteCarlo
+
+  Usage:
+    ./roomMonteCarlo [trials] [transmitters] [receivers] [seconds] [workers] [lbt] [visibility %] [seed]
+*/
+
+#include "PFHost.h"
+
+#include <PFTransmitter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+  const int pinIrLed      = 8;
+  const int pinIrReceiver = 7;
+
+  // Mean time between two commands of a transmitter, no commands shortly before the end of a trial
+  const unsigned long commandInterval = 1000000; // us
+  const unsigned long settleTime      = 1000000; // us
+
+  // Clock drift of the controllers (ceramic resonator)
+  const double maximumDrift = 0.005;
+
+  struct parameters_t
+  {
+    unsigned long duration;
+    bool          listenBeforeTalk;
+    int           receivers;
+    unsigned long seed;
+    int           transmitters;
+    unsigned long trials;
+    double        visibility;
+  };
+
+  /*
+    Command of a transmitter, time in controller microseconds until it ran, then in room nanoseconds
+  */
+  struct command_t
+  {
+    unsigned long long               time;
+    PF_n::transmitter_c::pwmOutput_t outputA;
+    PF_n::transmitter_c::pwmOutput_t outputB;
+  };
+
+  /*
+    Results of one channel
+  */
+  struct channelResult_t
+  {
+    unsigned long                     commands;
+    unsigned long                     conflicts;
+    unsigned long                     delivered;
+    unsigned long                     framesDelivered;
+    unsigned long                     framesSent;
+    std::vector< unsigned long long > latencies;
+  };
+
+  /*
+    Results of one worker
+  */
+  struct result_t
+  {
+    channelResult_t channels[ PF_n::transmitter_c::CHANNEL_NUM ];
+    unsigned long   collisions;
+    unsigned long   deferrals;
+  };
+
+  /*
+    Program of one controller
+  */
+  void runController( PF_n::host_n::mcu_c& mcu, PF_n::transmitter_c::channel_t channel, bool listenBeforeTalk,
+                      unsigned long duration, std::vector< command_t >& commands, result_t& result )
+  {
+    mcu.activate();
+    mcu.setLedPin( pinIrLed );
+    mcu.setReceiverPin( pinIrReceiver );
+
+    PF_n::transmitter_c transmitter( pinIrLed, listenBeforeTalk ? pinIrReceiver : -1 );
+    size_t              next = 0;
+
+    while ( mcu.micros() < duration )
+    {
+      while ( next < commands.size() && commands[ next ].time <= mcu.micros() )
+      {
+        transmitter.setMessageComboPWM( channel, commands[ next ].outputA, false, commands[ next ].outputB, false );
+        commands[ next ].time = mcu.time();
+        next++;
+      }
+      transmitter.sendMessages();
+    }
+
+    commands.resize( next );
+
+    result.deferrals = transmitter.deferrals();
+    result.collisions = transmitter.collisions();
+
+    mcu.finish();
+  }
+
+  /*
+    Order frames by time
+  */
+  bool earlier( const PF_n::host_n::frame_t& left, const PF_n::host_n::frame_t& right )
+  {
+    return left.time < right.time;
+  }
+
+  /*
+    Check if a sent frame was decoded unchanged by a receiver
+  */
+  bool received( const std::vector< PF_n::host_n::frame_t >& frames, const PF_n::host_n::frame_t& frame )
+  {
+    std::vector< PF_n::host_n::frame_t >::const_iterator candidate =
+      std::lower_bound( frames.begin(), frames.end(), frame, earlier );
+
+    return candidate != frames.end() && candidate->time == frame.time &&
+           std::equal( frame.nibbles, frame.nibbles + 4, candidate->nibbles );
+  }
+
+  /*
+    End of a frame: the receiver acts after the stop bit, the 18th mark of the frame
+  */
+  unsigned long long frameEnd( const std::vector< PF_n::host_n::mark_t >& marks, const PF_n::host_n::frame_t& frame )
+  {
+    std::vector< PF_n::host_n::mark_t >::const_iterator mark =
+      std::lower_bound( marks.begin(), marks.end(), frame.time,
+                        []( const PF_n::host_n::mark_t& left, unsigned long long right ) { return left.start < right; } );
+
+    return marks.end() - mark > 17 ? ( mark + 17 )->end : frame.time;
+  }
+
+  /*
+    Run one trial and add to the results of the worker
+  */
+  void simulate( const parameters_t& parameters, unsigned long trial, result_t& result )
+  {
+    std::mt19937                                        random( parameters.seed * 1000003UL + trial );
+    std::uniform_real_distribution<>                    drift( -maximumDrift, maximumDrift );
+    std::uniform_int_distribution< long >               offset( 0, 5 * 16000000L );
+    std::exponential_distribution<>                     interval( 1.0 / commandInterval );
+    std::uniform_int_distribution< int >                pwm( 0, 15 );
+    std::uniform_real_distribution<>                    chance( 0.0, 1.0 );
+    PF_n::host_n::room_c                                room;
+    std::vector< PF_n::host_n::mcu_c* >                 mcus;
+    std::vector< std::vector< command_t > >             commands( parameters.transmitters );
+    std::vector< result_t >                             results( parameters.transmitters );
+    std::vector< std::function< void() > >              programs;
+    std::vector< std::vector< PF_n::host_n::mark_t > >  marks;
+    std::vector< std::vector< PF_n::host_n::frame_t > > sent;
+
+    for ( int transmitter = 0; transmitter < parameters.transmitters; transmitter++ )
+    {
+      mcus.push_back( new PF_n::host_n::mcu_c( room, random(), drift( random ), offset( random ) ) );
+
+      for ( double time = 0; time < parameters.duration - settleTime; time += interval( random ) )
+      {
+        const command_t command = { static_cast< unsigned long long >( time ), PF_n::transmitter_c::pwmOutput_t( pwm( random ) ),
+                                    PF_n::transmitter_c::pwmOutput_t( pwm( random ) ) };
+        commands[ transmitter ].push_back( command );
+      }
+    }
+
+    // IR-LEDs the IR-receiver of each controller sees, drawn like the sets of the receivers
+    for ( int transmitter = 0; transmitter < parameters.transmitters; transmitter++ )
+    {
+      std::vector< PF_n::host_n::mcu_c* > visible;
+
+      for ( int other = 0; other < parameters.transmitters; other++ )
+      {
+        if ( other == transmitter || chance( random ) < parameters.visibility )
+        {
+          visible.push_back( mcus[ other ] );
+        }
+      }
+      mcus[ transmitter ]->setVisible( visible );
+    }
+
+    for ( int transmitter = 0; transmitter < parameters.transmitters; transmitter++ )
+    {
+      programs.push_back( std::bind( runController, std::ref( *mcus[ transmitter ] ),
+                                     PF_n::transmitter_c::channel_t( transmitter % PF_n::transmitter_c::CHANNEL_NUM ),
+                                     parameters.listenBeforeTalk, parameters.duration, std::ref( commands[ transmitter ] ),
+                                     std::ref( results[ transmitter ] ) ) );
+    }
+
+    room.run( programs );
+
+    for ( int transmitter = 0; transmitter < parameters.transmitters; transmitter++ )
+    {
+      marks.push_back( mcus[ transmitter ]->marks() );
+      sent.push_back( PF_n::host_n::receiver_c::decode( marks.back() ) );
+
+      result.deferrals += results[ transmitter ].deferrals;
+      result.collisions += results[ transmitter ].collisions;
+
+      delete mcus[ transmitter ];
+    }
+
+    for ( int receiver = 0; receiver < parameters.receivers; receiver++ )
+    {
+      const int                                          owner = receiver % parameters.transmitters;
+      channelResult_t&                                   channel = result.channels[ owner % PF_n::transmitter_c::CHANNEL_NUM ];
+      std::vector< int >                                 visible;
+      std::vector< std::vector< PF_n::host_n::mark_t > > visibleMarks;
+
+      for ( int transmitter = 0; transmitter < parameters.transmitters; transmitter++ )
+      {
+        if ( transmitter == owner || chance( random ) < parameters.visibility )
+        {
+          visible.push_back( transmitter );
+          visibleMarks.push_back( marks[ transmitter ] );
+        }
+      }
+
+      const std::vector< PF_n::host_n::frame_t > frames =
+        PF_n::host_n::receiver_c::decode( PF_n::host_n::receiver_c::merge( visibleMarks ) );
+
+      // Commands of the own transmitter, every frame belongs to the last command set before it started
+      const std::vector< command_t >&             ownCommands = commands[ owner ];
+      const std::vector< PF_n::host_n::frame_t >& ownFrames = sent[ owner ];
+      size_t                                      frame = 0;
+
+      for ( size_t command = 0; command < ownCommands.size(); command++ )
+      {
+        const unsigned long long end = command + 1 < ownCommands.size() ? ownCommands[ command + 1 ].time : ~0ULL;
+        bool                     delivered = false;
+
+        while ( frame < ownFrames.size() && ownFrames[ frame ].time < ownCommands[ command ].time )
+        {
+          frame++;
+        }
+
+        for ( ; frame < ownFrames.size() && ownFrames[ frame ].time < end; frame++ )
+        {
+          channel.framesSent++;
+
+          if ( received( frames, ownFrames[ frame ] ) )
+          {
+            channel.framesDelivered++;
+
+            if ( !delivered )
+            {
+              channel.latencies.push_back( frameEnd( marks[ owner ], ownFrames[ frame ] ) - ownCommands[ command ].time );
+              delivered = true;
+            }
+          }
+        }
+
+        channel.commands++;
+        channel.delivered += delivered ? 1 : 0;
+      }
+
+      // Frames of other transmitters on the same channel which the receiver obeys as well
+      for ( size_t other = 0; other < visible.size(); other++ )
+      {
+        if ( visible[ other ] != owner &&
+             visible[ other ] % PF_n::transmitter_c::CHANNEL_NUM == owner % PF_n::transmitter_c::CHANNEL_NUM )
+        {
+          for ( size_t foreign = 0; foreign < sent[ visible[ other ] ].size(); foreign++ )
+          {
+            channel.conflicts += received( frames, sent[ visible[ other ] ][ foreign ] ) ? 1 : 0;
+          }
+        }
+      }
+    }
+  }
+
+  /*
+    Worker: runs trials until all are taken
+  */
+  void runWorker( const parameters_t& parameters, std::atomic< unsigned long >& nextTrial, result_t& result )
+  {
+    for ( unsigned long trial = nextTrial++; trial < parameters.trials; trial = nextTrial++ )
+    {
+      simulate( parameters, trial, result );
+    }
+  }
+
+  /*
+    Percentile of sorted latencies in milliseconds
+  */
+  double percentile( const std::vector< unsigned long long >& latencies, double fraction )
+  {
+    if ( latencies.empty() )
+    {
+      return 0.0;
+    }
+
+    return latencies[ static_cast< size_t >( fraction * ( latencies.size() - 1 ) ) ] / 1e6;
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  parameters_t parameters;
+
+  parameters.trials           = argc > 1 ? std::strtoul( argv[ 1 ], 0, 10 ) : 1000;
+  parameters.transmitters     = argc > 2 ? std::atoi( argv[ 2 ] ) : 16;
+  parameters.receivers        = argc > 3 ? std::atoi( argv[ 3 ] ) : 32;
+  parameters.duration         = argc > 4 ? std::strtoul( argv[ 4 ], 0, 10 ) * 1000000UL : 10000000UL;
+  const unsigned int workers  = argc > 5 ? std::strtoul( argv[ 5 ], 0, 10 ) : std::max( 1U, std::thread::hardware_concurrency() );
+  parameters.listenBeforeTalk = argc > 6 ? std::atoi( argv[ 6 ] ) != 0 : true;
+  parameters.visibility       = argc > 7 ? std::atof( argv[ 7 ] ) / 100.0 : 0.5;
+  parameters.seed             = argc > 8 ? std::strtoul( argv[ 8 ], 0, 10 ) : 1;
+
+  if ( parameters.transmitters < 1 || parameters.receivers < 1 || workers < 1 || parameters.duration <= settleTime )
+  {
+    std::fprintf( stderr, "usage: %s [trials] [transmitters] [receivers] [seconds] [workers] [lbt] [visibility %%] [seed]\n",
+                  argv[ 0 ] );
+    return 1;
+  }
+
+  std::atomic< unsigned long > nextTrial( 0 );
+  std::vector< result_t >      results( workers );
+  std::vector< std::thread >   threads;
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for ( unsigned int worker = 0; worker < workers; worker++ )
+  {
+    results[ worker ] = result_t();
+    threads.push_back( std::thread( runWorker, std::cref( parameters ), std::ref( nextTrial ), std::ref( results[ worker ] ) ) );
+  }
+
+  for ( size_t thread = 0; thread < threads.size(); thread++ )
+  {
+    threads[ thread ].join();
+  }
+
+  const double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+  // Merge the workers
+  result_t total = result_t();
+
+  for ( unsigned int worker = 0; worker < workers; worker++ )
+  {
+    for ( int channel = PF_n::transmitter_c::CHANNEL_1; channel < PF_n::transmitter_c::CHANNEL_NUM; channel++ )
+    {
+      const channelResult_t& from = results[ worker ].channels[ channel ];
+      channelResult_t&       to = total.channels[ channel ];
+
+      to.commands += from.commands;
+      to.conflicts += from.conflicts;
+      to.delivered += from.delivered;
+      to.framesDelivered += from.framesDelivered;
+      to.framesSent += from.framesSent;
+      to.latencies.insert( to.latencies.end(), from.latencies.begin(), from.latencies.end() );
+    }
+    total.deferrals += results[ worker ].deferrals;
+    total.collisions += results[ worker ].collisions;
+  }
+
+  std::printf( "%lu trials, %d transmitters, %d receivers, %lu s, listen before talk %s, visibility %.0f %%\n",
+               parameters.trials, parameters.transmitters, parameters.receivers, parameters.duration / 1000000UL,
+               parameters.listenBeforeTalk ? "on" : "off", 100.0 * parameters.visibility );
+  std::printf( "channel  commands  delivered  frames    latency p50    p90      p99 ms  conflicts\n" );
+
+  for ( int channel = PF_n::transmitter_c::CHANNEL_1; channel < PF_n::transmitter_c::CHANNEL_NUM; channel++ )
+  {
+    channelResult_t& result = total.channels[ channel ];
+
+    std::sort( result.latencies.begin(), result.latencies.end() );
+
+    std::printf( "%7d  %8lu  %8.2f%%  %6.2f%%  %11.1f  %6.1f  %9.1f  %9lu\n", channel + 1, result.commands,
+                 result.commands > 0 ? 100.0 * result.delivered / result.commands : 0.0,
+                 result.framesSent > 0 ? 100.0 * result.framesDelivered / result.framesSent : 0.0,
+                 percentile( result.latencies, 0.5 ), percentile( result.latencies, 0.9 ),
+                 percentile( result.latencies, 0.99 ), result.conflicts );
+  }
+
+  std::printf( "deferrals %lu, collisions %lu\n", total.deferrals, total.collisions );
+  std::printf( "%u workers, %.1f s, %.2f trials/s\n", workers, seconds, parameters.trials / seconds );
+
+  return 0;
+}
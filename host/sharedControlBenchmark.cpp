@@ -0,0 +1,257 @@
+/*
+  Throughput and latency of the shared control segment with several writer processes.
+
+  The parent runs a host transmitter which writes LIRC mode2 text to /dev/null in real time and picks up the shared
+  slots between two rounds. Every writer process maps the segment by name and
+  - first sets Combo-PWM messages on its channel as fast as it can (throughput of the lock-free updates),
+  - then sets a message, waits until the transmitter picked it up and pauses a random time of up to two rounds
+    (latency).
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp host/PFHost.cpp host/PFLircOutput.cpp host/PFHostTransmitter.cpp host/sharedControlBenchmark.cpp -o sharedControlBenchmark -lrt
+
+  Usage:
+    ./sharedControlBenchmark [seconds] [writer processes]
+*/
+
+#include "PFHostTransmitter.h"
+#include "PFLircOutput.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <random>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+  typedef std::chrono::steady_clock monotonic_t;
+
+  /*
+    Results of one writer, sent to the parent through a pipe, followed by the latencies
+  */
+  struct result_t
+  {
+    unsigned long latencies;
+    double        seconds;
+    unsigned long writes;
+  };
+
+  /*
+    Write all bytes to a pipe
+  */
+  bool writeAll( int fd, const void* data, size_t size )
+  {
+    const char* bytes = static_cast< const char* >( data );
+
+    while ( size > 0 )
+    {
+      const ssize_t written = ::write( fd, bytes, size );
+
+      if ( written <= 0 )
+      {
+        return false;
+      }
+      bytes += written;
+      size -= written;
+    }
+
+    return true;
+  }
+
+  /*
+    Read all bytes from a pipe
+  */
+  bool readAll( int fd, void* data, size_t size )
+  {
+    char* bytes = static_cast< char* >( data );
+
+    while ( size > 0 )
+    {
+      const ssize_t received = ::read( fd, bytes, size );
+
+      if ( received <= 0 )
+      {
+        return false;
+      }
+      bytes += received;
+      size -= received;
+    }
+
+    return true;
+  }
+
+  /*
+    Writer process
+  */
+  int runWriter( const char* name, int index, double seconds, int fd )
+  {
+    PF_n::host_n::sharedControl_c        control;
+    std::mt19937                         random( index );
+    std::uniform_int_distribution< int > pwm( 0, 15 );
+    std::uniform_int_distribution< int > pause( 0, 160000 );
+    const PF_n::transmitter_c::channel_t channel =
+      PF_n::transmitter_c::channel_t( index % PF_n::transmitter_c::CHANNEL_NUM );
+    result_t                             result = { 0, 0.0, 0 };
+    std::vector< unsigned long >         latencies;
+
+    if ( !control.open( name ) )
+    {
+      std::fprintf( stderr, "writer %d: can't open %s\n", index, name );
+      return 1;
+    }
+
+    // Throughput
+    const monotonic_t::time_point start = monotonic_t::now();
+    const monotonic_t::time_point end = start + std::chrono::microseconds( static_cast< long long >( seconds * 5e5 ) );
+
+    while ( monotonic_t::now() < end )
+    {
+      for ( int write = 0; write < 1000; write++ )
+      {
+        control.setMessageComboPWM( channel, PF_n::transmitter_c::pwmOutput_t( write & 0xF ),
+                                    PF_n::transmitter_c::pwmOutput_t( ( write >> 4 ) & 0xF ) );
+      }
+      result.writes += 1000;
+    }
+    result.seconds = std::chrono::duration< double >( monotonic_t::now() - start ).count();
+
+    // Latency until the transmitter picked up the message (or a newer one of the same channel)
+    const monotonic_t::time_point latencyEnd = monotonic_t::now() + ( end - start );
+
+    while ( monotonic_t::now() < latencyEnd )
+    {
+      const monotonic_t::time_point written = monotonic_t::now();
+      const unsigned long           version =
+        control.setMessageComboPWM( channel, PF_n::transmitter_c::pwmOutput_t( pwm( random ) ),
+                                    PF_n::transmitter_c::pwmOutput_t( pwm( random ) ) );
+
+      while ( static_cast< long >( control.applied( channel ) - version ) < 0 && monotonic_t::now() < latencyEnd )
+      {
+        std::this_thread::yield();
+      }
+
+      if ( static_cast< long >( control.applied( channel ) - version ) >= 0 )
+      {
+        latencies.push_back( std::chrono::duration_cast< std::chrono::microseconds >( monotonic_t::now() - written ).count() );
+      }
+
+      std::this_thread::sleep_for( std::chrono::microseconds( pause( random ) ) );
+    }
+
+    result.latencies = latencies.size();
+
+    return writeAll( fd, &result, sizeof( result ) ) &&
+           writeAll( fd, latencies.data(), latencies.size() * sizeof( unsigned long ) ) ? 0 : 1;
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  const double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 10.0;
+  const int    writers = argc > 2 ? std::atoi( argv[ 2 ] ) : 3;
+  char         name[ 64 ];
+
+  if ( seconds <= 0 || writers < 1 )
+  {
+    std::fprintf( stderr, "usage: %s [seconds] [writer processes]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  std::snprintf( name, sizeof( name ), "/pf-benchmark-%d", static_cast< int >( ::getpid() ) );
+
+  PF_n::host_n::sharedControl_c control;
+
+  if ( !control.create( name ) )
+  {
+    std::perror( name );
+    return 1;
+  }
+
+  // Fork before any thread is started
+  std::vector< pid_t > pids;
+  std::vector< int >   pipes;
+
+  for ( int writer = 0; writer < writers; writer++ )
+  {
+    int fds[ 2 ];
+
+    if ( ::pipe( fds ) != 0 )
+    {
+      std::perror( "pipe" );
+      return 1;
+    }
+
+    const pid_t pid = ::fork();
+
+    if ( pid == 0 )
+    {
+      ::close( fds[ 0 ] );
+      control.close();
+      ::_exit( runWriter( name, writer, seconds, fds[ 1 ] ) );
+    }
+
+    ::close( fds[ 1 ] );
+    pids.push_back( pid );
+    pipes.push_back( fds[ 0 ] );
+  }
+
+  const int                       fd = ::open( "/dev/null", O_WRONLY );
+  PF_n::host_n::lircOutput_c      output( fd );
+  PF_n::host_n::hostTransmitter_c transmitter( output, &control );
+
+  transmitter.start();
+
+  // Collect results
+  std::vector< unsigned long > latencies;
+  double                       writesPerSecond = 0;
+
+  for ( int writer = 0; writer < writers; writer++ )
+  {
+    result_t result;
+
+    if ( readAll( pipes[ writer ], &result, sizeof( result ) ) )
+    {
+      std::vector< unsigned long > writerLatencies( result.latencies );
+
+      if ( readAll( pipes[ writer ], writerLatencies.data(), writerLatencies.size() * sizeof( unsigned long ) ) )
+      {
+        latencies.insert( latencies.end(), writerLatencies.begin(), writerLatencies.end() );
+      }
+      writesPerSecond += result.writes / result.seconds;
+
+      std::printf( "writer %d  channel %d  %.2f M writes/s\n", writer, writer % PF_n::transmitter_c::CHANNEL_NUM + 1,
+                   result.writes / result.seconds / 1e6 );
+    }
+    else
+    {
+      std::fprintf( stderr, "writer %d failed\n", writer );
+    }
+
+    ::close( pipes[ writer ] );
+    ::waitpid( pids[ writer ], 0, 0 );
+  }
+
+  transmitter.stop();
+  ::close( fd );
+  PF_n::host_n::sharedControl_c::remove( name );
+
+  std::sort( latencies.begin(), latencies.end() );
+
+  std::printf( "total     %.2f M writes/s, %d processes\n", writesPerSecond / 1e6, writers );
+  std::printf( "rounds    %lu\n", transmitter.rounds() );
+
+  if ( !latencies.empty() )
+  {
+    std::printf( "pick up   %lu samples: median %.1f ms, 90 %% %.1f ms, 99 %% %.1f ms, maximum %.1f ms\n", latencies.size(),
+                 latencies[ latencies.size() / 2 ] / 1e3, latencies[ latencies.size() * 9 / 10 ] / 1e3,
+                 latencies[ latencies.size() * 99 / 100 ] / 1e3, latencies.back() / 1e3 );
+  }
+
+  return 0;
+}
@@ -0,0 +1,250 @@
+/*
+  Check of the bitstream rendered by shiftOutput_c against the timing of the specification.
+
+  The library sends the same messages to shiftOutput_c and to a recorded schedule. The bitstream is split into
+  marks and spaces again; every mark must be a clean carrier of 6 cycles, every bit must have the length of a
+  low, high or start/stop bit, messages must start in 16 ms slots and decode to the same messages as the schedule.
+  A round of messages on all channels (all bits high, the longest messages) must fit into the queue.
+
+  Build:
+    g++ -std=c++11 -O2 -pthread -I host -I . PFTransmitter.cpp PFOutput.cpp PFShiftOutput.cpp host/PFHost.cpp host/shiftOutputCheck.cpp -o shiftOutputCheck
+*/
+
+#include "PFHost.h"
+
+#include <PFShiftOutput.h>
+#include <PFTransmitter.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+  /*
+    Output which collects the rendered bytes instead of shifting them out
+  */
+  class captureOutput_c : public PF_n::shiftOutput_c
+  {
+  public:
+    captureOutput_c() :
+      _waits( 0 )
+    {
+    }
+
+    void drain()
+    {
+      while ( !empty() )
+      {
+        _bytes.push_back( render() );
+      }
+    }
+
+    const std::vector< unsigned char >& bytes() const
+    {
+      return _bytes;
+    }
+
+    unsigned long waits() const
+    {
+      return _waits;
+    }
+
+  protected:
+    virtual void waitForRoom()
+    {
+      _waits++;
+      _bytes.push_back( render() );
+    }
+
+  private:
+    std::vector< unsigned char > _bytes;
+    unsigned long                _waits;
+  };
+
+  /*
+    Set some messages, sent the same way to all outputs
+  */
+  void sendMessages( PF_n::output_c& output, unsigned long rounds )
+  {
+    PF_n::transmitter_c transmitter( output );
+
+    for ( unsigned long round = 0; round < rounds; round++ )
+    {
+      transmitter.setMessageComboPWM( PF_n::transmitter_c::CHANNEL_1, PF_n::transmitter_c::pwmOutput_t( round % 16 ), false,
+                                      PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_3, false );
+      if ( round % 7 == 0 )
+      {
+        transmitter.setMessageSingleOutputPWM( PF_n::transmitter_c::CHANNEL_3, PF_n::transmitter_c::SINGLE_OUTPUT_B,
+                                               PF_n::transmitter_c::PWM_OUTPUT_FORWARD_7, false );
+      }
+      transmitter.setMessageComboDirect( PF_n::transmitter_c::CHANNEL_4, PF_n::transmitter_c::COMBO_DIRECT_OUTPUT_BACKWARD, false,
+                                         PF_n::transmitter_c::COMBO_DIRECT_OUTPUT_BRAKE_FLOAT, false );
+      transmitter.sendMessages();
+    }
+  }
+
+  /*
+    Count a failed check
+  */
+  void check( bool condition, unsigned long& failures, const char* what, unsigned long sample )
+  {
+    if ( !condition )
+    {
+      if ( failures < 10 )
+      {
+        std::printf( "FAIL: %s at sample %lu\n", what, sample );
+      }
+      failures++;
+    }
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  const unsigned long rounds = argc > 1 ? std::strtoul( argv[ 1 ], 0, 10 ) : 200;
+
+  captureOutput_c                bitstream;
+  PF_n::host_n::scheduleOutput_c schedule;
+
+  sendMessages( bitstream, rounds );
+  sendMessages( schedule, rounds );
+  bitstream.drain();
+
+  std::vector< bool > samples;
+
+  for ( std::vector< unsigned char >::const_iterator byte = bitstream.bytes().begin(); byte != bitstream.bytes().end(); ++byte )
+  {
+    for ( int bit = 7; bit >= 0; bit-- )
+    {
+      samples.push_back( ( *byte & ( 1 << bit ) ) != 0 );
+    }
+  }
+
+  const double        sampleLength = 1e6 / bitstream.sampleRate();
+  const unsigned long cycleSamples = 2;
+  unsigned long       failures = 0;
+
+  // Split into marks, a mark is a sequence of 1,0 pairs
+  std::vector< PF_n::host_n::mark_t > marks;
+  std::vector< unsigned long >        markStarts;
+
+  for ( unsigned long sample = 0; sample < samples.size(); )
+  {
+    if ( !samples[ sample ] )
+    {
+      sample++;
+      continue;
+    }
+
+    const unsigned long start = sample;
+
+    while ( sample + 1 < samples.size() && samples[ sample ] && !samples[ sample + 1 ] )
+    {
+      sample += cycleSamples;
+    }
+
+    check( sample >= samples.size() || !samples[ sample ] || sample == start, failures, "carrier not alternating", sample );
+    check( sample - start == 6 * cycleSamples, failures, "mark is not 6 cycles", start );
+
+    PF_n::host_n::mark_t mark = { static_cast< unsigned long long >( start * sampleLength * 1000 ),
+                                  static_cast< unsigned long long >( sample * sampleLength * 1000 ) };
+    marks.push_back( mark );
+    markStarts.push_back( start );
+
+    if ( sample == start )
+    {
+      sample++;
+    }
+  }
+
+  // Length of bits (start of mark to start of next mark) in carrier cycles
+  const unsigned long lowBit   = 6 + 10;
+  const unsigned long highBit  = 6 + 21;
+  const unsigned long startBit = 6 + 39;
+  double              maximumDeviation = 0;
+  unsigned long       frameStart = 0;
+  unsigned long       frames = 0;
+
+  for ( size_t mark = 0; mark + 1 < markStarts.size(); mark++ )
+  {
+    const unsigned long length = markStarts[ mark + 1 ] - markStarts[ mark ];
+    const bool          inFrame = mark % 18 != 17;
+
+    if ( mark % 18 == 0 )
+    {
+      // Messages start in slots of 16 ms
+      if ( mark > 0 )
+      {
+        const double slots = ( markStarts[ mark ] - frameStart ) * sampleLength / 16000;
+        const double deviation = std::fabs( slots - std::floor( slots + 0.5 ) ) * 16000;
+
+        check( deviation <= 2 * sampleLength * std::floor( slots + 0.5 ), failures, "message not in 16 ms slot",
+               markStarts[ mark ] );
+      }
+      frameStart = markStarts[ mark ];
+      frames++;
+    }
+
+    if ( inFrame )
+    {
+      const unsigned long expected = mark % 18 == 0 ? startBit : ( length < ( lowBit + highBit ) ? lowBit : highBit );
+      const double        deviation = std::fabs( double( length ) - double( expected * cycleSamples ) ) * sampleLength;
+
+      maximumDeviation = deviation > maximumDeviation ? deviation : maximumDeviation;
+      check( deviation <= 1.5 * sampleLength, failures, "bit length", markStarts[ mark ] );
+    }
+  }
+
+  // Decoded messages must match the recorded schedule
+  std::vector< PF_n::host_n::mark_t > scheduleMarks;
+  unsigned long long                  time = 0;
+
+  for ( std::vector< PF_n::host_n::pulse_t >::const_iterator pulse = schedule.pulses().begin();
+        pulse != schedule.pulses().end(); ++pulse )
+  {
+    if ( pulse->mark )
+    {
+      PF_n::host_n::mark_t mark = { time, time + pulse->duration * 1000ULL };
+      scheduleMarks.push_back( mark );
+    }
+    time += pulse->duration * 1000ULL;
+  }
+
+  const std::vector< PF_n::host_n::frame_t > decoded  = PF_n::host_n::receiver_c::decode( marks );
+  const std::vector< PF_n::host_n::frame_t > expected = PF_n::host_n::receiver_c::decode( scheduleMarks );
+
+  check( decoded.size() == expected.size(), failures, "number of messages", 0 );
+
+  for ( size_t frame = 0; frame < decoded.size() && frame < expected.size(); frame++ )
+  {
+    check( std::equal( decoded[ frame ].nibbles, decoded[ frame ].nibbles + 4, expected[ frame ].nibbles ), failures,
+           "message differs from schedule", static_cast< unsigned long >( decoded[ frame ].time / 1000 / sampleLength ) );
+  }
+
+  // A round with messages on all channels fits into the empty queue, sendMessages() doesn't wait
+  captureOutput_c     roundOutput;
+  PF_n::transmitter_c roundTransmitter( roundOutput, 7 );
+
+  for ( unsigned long round = 0; round < 10; round++ )
+  {
+    for ( int channel = PF_n::transmitter_c::CHANNEL_1; channel < PF_n::transmitter_c::CHANNEL_NUM; channel++ )
+    {
+      roundTransmitter.setMessageComboPWM( PF_n::transmitter_c::channel_t( channel ), PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1,
+                                           false, PF_n::transmitter_c::PWM_OUTPUT_BACKWARD_1, false );
+    }
+
+    roundOutput.drain();
+    check( roundOutput.available() >= PF_n::shiftOutput_c::roundRuns(), failures, "queue too small for a round", round );
+    roundTransmitter.sendMessages();
+    check( roundOutput.waits() == 0, failures, "round waited for the queue", round );
+  }
+  check( roundTransmitter.deferrals() == 0, failures, "listen before talk with queued output", 0 );
+
+  std::printf( "carrier %.1f Hz, %lu bytes, %lu messages, %lu decoded, maximum bit deviation %.1f us\n",
+               bitstream.sampleRate() / 2.0, static_cast< unsigned long >( bitstream.bytes().size() ), frames,
+               static_cast< unsigned long >( decoded.size() ), maximumDeviation );
+  std::printf( "%s\n", failures == 0 ? "PASS" : "FAIL" );
+
+  return failures == 0 ? 0 : 1;
+}
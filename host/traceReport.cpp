@@ -0,0 +1,138 @@
+/*
+  Per-phase breakdown of a trace dump (trace_c::dump(), one "event time" per line).
+
+  Build:
+    g++ -std=c++11 -O2 -I . host/traceReport.cpp -o traceReport
+
+  Usage:
+    ./traceReport < dump.txt
+*/
+
+#include <PFTrace.h>
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+  struct phase_t
+  {
+    const char*        name;
+    unsigned long      count;
+    unsigned long long total;
+    unsigned long long maximum;
+    unsigned long long begin;
+    bool               open;
+  };
+
+  /*
+    Get duration between two time stamps, 32 bit counters may wrap around
+  */
+  unsigned long long duration( unsigned long long begin, unsigned long long end, bool wide )
+  {
+    return wide ? end - begin : ( end - begin ) & 0xFFFFFFFFULL;
+  }
+}
+
+int main()
+{
+  phase_t phases[ PF_n::trace_c::EVENT_NUM / 2 ] = {
+    { "send",    0, 0, 0, 0, false },
+    { "lbt",     0, 0, 0, 0, false },
+    { "encode",  0, 0, 0, 0, false },
+    { "nibbles", 0, 0, 0, 0, false },
+    { "mark",    0, 0, 0, 0, false },
+    { "padding", 0, 0, 0, 0, false }
+  };
+  const unsigned int                phaseNum = sizeof( phases ) / sizeof( phases[ 0 ] );
+  double                            ticksPerMicrosecond = 1;
+  std::vector< unsigned int >       events;
+  std::vector< unsigned long long > times;
+  bool                              wide = false;
+  char                              line[ 128 ];
+
+  while ( std::fgets( line, sizeof( line ), stdin ) != 0 )
+  {
+    unsigned int       event;
+    unsigned long long time;
+
+    if ( std::sscanf( line, "# ticks/us %lf", &ticksPerMicrosecond ) == 1 )
+    {
+      continue;
+    }
+    if ( std::sscanf( line, "%u %llu", &event, &time ) == 2 && event < PF_n::trace_c::EVENT_NUM )
+    {
+      events.push_back( event );
+      times.push_back( time );
+      wide = wide || time > 0xFFFFFFFFULL;
+    }
+  }
+
+  // Only complete messages: the ring buffer may have overwritten the beginning of the oldest one
+  size_t first = 0;
+  size_t end = events.size();
+
+  while ( first < end && events[ first ] != PF_n::trace_c::EVENT_SEND_BEGIN )
+  {
+    first++;
+  }
+  while ( end > first && events[ end - 1 ] != PF_n::trace_c::EVENT_SEND_END )
+  {
+    end--;
+  }
+
+  // Marks inside the nibbles are counted separately, the rest of the nibbles are the spaces of the bits
+  unsigned long long marksInNibbles = 0;
+
+  for ( size_t index = first; index < end; index++ )
+  {
+    phase_t& phase = phases[ events[ index ] / 2 ];
+
+    if ( events[ index ] % 2 == 0 )
+    {
+      phase.begin = times[ index ];
+      phase.open = true;
+    }
+    else if ( phase.open )
+    {
+      const unsigned long long length = duration( phase.begin, times[ index ], wide );
+
+      phase.count++;
+      phase.total += length;
+      phase.maximum = length > phase.maximum ? length : phase.maximum;
+      phase.open = false;
+
+      if ( events[ index ] == PF_n::trace_c::EVENT_MARK_END && phases[ PF_n::trace_c::EVENT_NIBBLES_BEGIN / 2 ].open )
+      {
+        marksInNibbles += length;
+      }
+    }
+  }
+
+  const double sendTotal = phases[ 0 ].total > 0 ? phases[ 0 ].total : 1;
+
+  std::printf( "%-16s %8s %12s %10s %10s %7s\n", "phase", "count", "total us", "mean us", "max us", "share" );
+
+  for ( unsigned int phase = 0; phase < phaseNum; phase++ )
+  {
+    if ( phases[ phase ].count == 0 )
+    {
+      continue;
+    }
+
+    std::printf( "%-16s %8lu %12.1f %10.2f %10.2f %6.1f%%\n", phases[ phase ].name, phases[ phase ].count,
+                 phases[ phase ].total / ticksPerMicrosecond,
+                 phases[ phase ].total / ticksPerMicrosecond / phases[ phase ].count,
+                 phases[ phase ].maximum / ticksPerMicrosecond, 100.0 * phases[ phase ].total / sendTotal );
+  }
+
+  const phase_t& nibbles = phases[ PF_n::trace_c::EVENT_NIBBLES_BEGIN / 2 ];
+
+  if ( nibbles.count > 0 )
+  {
+    std::printf( "%-16s %8s %12.1f %10s %10s %6.1f%%\n", "nibble spaces", "", ( nibbles.total - marksInNibbles ) / ticksPerMicrosecond,
+                 "", "", 100.0 * ( nibbles.total - marksInNibbles ) / sendTotal );
+  }
+
+  return 0;
+}